@@ -0,0 +1,435 @@
+#include "blesource.h"
+
+#include "hostclock.h"
+
+#define SERVICE_UUID        "6e400001-b5a3-f393-e0a9-e50e24dcca9e"
+#define CHARACTERISTIC_UUID "6e400002-b5a3-f393-e0a9-e50e24dcca9e"
+#define CONTROL_CHARACTERISTIC_UUID "6e400003-b5a3-f393-e0a9-e50e24dcca9e"
+
+// Clock sync pings: a quick burst after connecting for a first estimate,
+// then a steady rate to follow drift
+#define PING_BURST 8
+#define PING_BURST_MS 100
+#define PING_INTERVAL_MS 1000
+
+// Wait before scanning again for a lost device
+#define RESCAN_DELAY_MS 5000
+
+// Check for retries and give-ups due while no notifications arrive
+#define SEQUENCER_TICK_MS 100
+
+// A burst that goes quiet this long without ending may have lost its last
+// packet, so the frames after the newest one are asked for
+#define TAIL_WAIT_MS 200
+#define TAIL_REQUEST_FRAMES 32
+
+BleSource::BleSource(const QBluetoothDeviceInfo &device, QObject *parent):
+    DataSource(parent),
+    device(device),
+    discoveryAgent(nullptr),
+    bleController(nullptr),
+    bleService(nullptr),
+    dataCharacteristic(),
+    controlCharacteristic(),
+    rescanTimer(nullptr),
+    stopped(false),
+    deviceConfigValid(false),
+    triggerForceLow(0.1),
+    triggerForceHigh(1.0),
+    reportedRejected(0),
+    reportedDropped(0),
+    reportedRecovered(0),
+    sequencerTimer(nullptr),
+    lastReceived(0),
+    lastSequence(0),
+    sequenceSeen(false),
+    tailOpen(false),
+    pingTimer(nullptr),
+    pingsSent(0)
+{
+}
+
+BleSource::~BleSource()
+{
+    stop();
+}
+
+void BleSource::start()
+{
+    // Created here so they belong to the thread the source runs on
+    pingTimer = new QTimer(this);
+    sequencerTimer = new QTimer(this);
+    sequencerTimer->setInterval(SEQUENCER_TICK_MS);
+    rescanTimer = new QTimer(this);
+    rescanTimer->setSingleShot(true);
+    rescanTimer->setInterval(RESCAN_DELAY_MS);
+    connect(pingTimer, &QTimer::timeout, this, &BleSource::onPingTimer);
+    connect(sequencerTimer, &QTimer::timeout, this, &BleSource::onSequencerTimer);
+    connect(rescanTimer, &QTimer::timeout, this, &BleSource::startScan);
+
+    // A given device is connected to directly, without scanning
+    if (!device.isValid()) {
+        discoveryAgent = new QBluetoothDeviceDiscoveryAgent(this);
+        connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered, this, &BleSource::onDeviceDiscovered);
+        connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::errorOccurred, this, &BleSource::onDeviceDiscoveryError);
+        connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::finished, this, &BleSource::onDeviceDiscoveryFinished);
+    }
+
+    stopped = false;
+    startScan();
+}
+
+bool BleSource::isTamper(const QBluetoothDeviceInfo &info)
+{
+    return info.name().contains("ESP32_Tamper"); // Replace with your BLE device name
+}
+
+void BleSource::startScan()
+{
+    if (stopped || bleController) return;
+
+    if (device.isValid()) {
+        connectDevice(device);
+        return;
+    }
+
+    emit statusMessage("Scanning for BLE devices...");
+    discoveryAgent->start();
+}
+
+void BleSource::stop()
+{
+    stopped = true;
+    if (rescanTimer) rescanTimer->stop();
+    if (bleController) {
+        bleController->disconnectFromDevice();
+        delete bleController;
+        bleController = nullptr;
+        bleService = nullptr;
+    }
+    if (discoveryAgent) discoveryAgent->stop();
+}
+
+void BleSource::setTriggerLevels(double low, double high)
+{
+    triggerForceLow = low;
+    triggerForceHigh = high;
+}
+
+void BleSource::writeDeviceConfig(const DeviceConfig &config)
+{
+    if (!deviceConfigValid) return;
+
+    deviceConfig = config;
+    sendDeviceConfig();
+}
+
+void BleSource::onDeviceDiscovered(const QBluetoothDeviceInfo &info)
+{
+    if (bleController) return;
+
+    if (isTamper(info)) {
+        emit statusMessage("Found BLE device: " + info.name());
+        discoveryAgent->stop();
+        connectDevice(info);
+    }
+}
+
+void BleSource::connectDevice(const QBluetoothDeviceInfo &info)
+{
+    bleController = QLowEnergyController::createCentral(info, this);
+    connect(bleController, &QLowEnergyController::connected, this, &BleSource::onConnected);
+    connect(bleController, &QLowEnergyController::errorOccurred, this, &BleSource::onErrorOccurred);
+    connect(bleController, &QLowEnergyController::disconnected, this, &BleSource::onDisconnected);
+    connect(bleController, &QLowEnergyController::serviceDiscovered, this, &BleSource::onServiceDiscovered);
+    connect(bleController, &QLowEnergyController::discoveryFinished, this, &BleSource::onServiceDiscoveryFinished);
+
+    emit statusMessage("Connecting to BLE device...");
+    bleController->connectToDevice();
+}
+
+void BleSource::onDeviceDiscoveryError(QBluetoothDeviceDiscoveryAgent::Error error)
+{
+    Q_UNUSED(error);
+    emit statusMessage("BLE device discovery error: " + discoveryAgent->errorString());
+    if (!stopped && !bleController) rescanTimer->start();
+}
+
+void BleSource::onDeviceDiscoveryFinished()
+{
+    // Not found this time, try again later
+    if (!stopped && !bleController) rescanTimer->start();
+}
+
+void BleSource::onConnected()
+{
+    emit statusMessage("Connected to BLE device");
+    bleController->discoverServices();
+}
+
+void BleSource::onDisconnected()
+{
+    emit statusMessage("Disconnected from BLE device");
+    reportRejected();
+    reportLatency();
+    pingTimer->stop();
+    sequencerTimer->stop();
+    decoder.reset();
+    reportedRejected = 0;
+    sequencer.reset();
+    sequenceSeen = false;
+    tailOpen = false;
+    clockSync.reset();
+    bleService = nullptr;
+    dataCharacteristic = QLowEnergyCharacteristic();
+    controlCharacteristic = QLowEnergyCharacteristic();
+    deviceConfigValid = false;
+    dropController();
+    emit disconnected();
+}
+
+void BleSource::onServiceDiscovered(const QBluetoothUuid &serviceUuid)
+{
+    if (serviceUuid == QBluetoothUuid(QString(SERVICE_UUID))) {
+        emit statusMessage("Found service: " + serviceUuid.toString());
+        bleService = bleController->createServiceObject(serviceUuid, this);
+        if (bleService) {
+            connect(bleService, &QLowEnergyService::stateChanged, this, &BleSource::onServiceStateChanged);
+            connect(bleService, &QLowEnergyService::characteristicChanged, this, &BleSource::onCharacteristicChanged);
+            connect(bleService, &QLowEnergyService::characteristicRead, this, &BleSource::onCharacteristicRead);
+            connect(bleService, &QLowEnergyService::characteristicWritten, this, &BleSource::onCharacteristicWritten);
+            bleService->discoverDetails();
+        }
+    }
+}
+
+void BleSource::onServiceDiscoveryFinished()
+{
+    emit statusMessage("Service discovery finished");
+}
+
+void BleSource::onServiceStateChanged(QLowEnergyService::ServiceState newState)
+{
+    if (newState == QLowEnergyService::RemoteServiceDiscovered) {
+        dataCharacteristic = bleService->characteristic(QBluetoothUuid(QString(CHARACTERISTIC_UUID)));
+        if (dataCharacteristic.isValid()) {
+            emit statusMessage("Found data characteristic");
+            bleService->writeDescriptor(dataCharacteristic.descriptor(QBluetoothUuid(QString("00002902-0000-1000-8000-00805f9b34fb"))),
+                                        QByteArray::fromHex("0100")); // Enable notifications
+        }
+
+        controlCharacteristic = bleService->characteristic(QBluetoothUuid(QString(CONTROL_CHARACTERISTIC_UUID)));
+        if (controlCharacteristic.isValid()) {
+            emit statusMessage("Found control characteristic");
+            bleService->readCharacteristic(controlCharacteristic); // Get active configuration
+
+            // Start synchronizing clocks
+            pingsSent = 0;
+            pingTimer->start(PING_BURST_MS);
+            onPingTimer();
+        }
+    }
+}
+
+void BleSource::onCharacteristicChanged(const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue)
+{
+    if (characteristic.uuid() == QBluetoothUuid(QString(CHARACTERISTIC_UUID))) {
+        processData(newValue);
+    }
+}
+
+void BleSource::onCharacteristicRead(const QLowEnergyCharacteristic &characteristic, const QByteArray &value)
+{
+    if (characteristic.uuid() != QBluetoothUuid(QString(CONTROL_CHARACTERISTIC_UUID))) return;
+
+    DeviceConfig config;
+    if (!DeviceConfig::fromBytes(value, config)) {
+        emit statusMessage("Unsupported device configuration");
+        return;
+    }
+
+    bool firstRead = !deviceConfigValid;
+    deviceConfig = config;
+    deviceConfigValid = true;
+    decoder.setCountsPerKg(deviceConfig.countsPerKg);
+    emit deviceConfigRead(deviceConfig);
+
+    // Have the device stream around the same trigger levels as the client
+    if (firstRead && (deviceConfig.armForce != float(triggerForceLow) ||
+                      deviceConfig.triggerForce != float(triggerForceHigh))) {
+        sendDeviceConfig();
+    }
+}
+
+void BleSource::onCharacteristicWritten(const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue)
+{
+    // Read back what the device actually applied
+    if (characteristic.uuid() == QBluetoothUuid(QString(CONTROL_CHARACTERISTIC_UUID)) &&
+        DeviceConfig::isSetCommand(newValue)) {
+        bleService->readCharacteristic(controlCharacteristic);
+    }
+}
+
+void BleSource::sendDeviceConfig()
+{
+    if (!bleService || !controlCharacteristic.isValid()) return;
+
+    deviceConfig.armForce = triggerForceLow;
+    deviceConfig.triggerForce = triggerForceHigh;
+    bleService->writeCharacteristic(controlCharacteristic, deviceConfig.toSetCommand());
+}
+
+void BleSource::onErrorOccurred(QLowEnergyController::Error error)
+{
+    Q_UNUSED(error);
+    emit statusMessage("BLE error: " + bleController->errorString());
+
+    // A connection that never came up gets no disconnected signal
+    if (bleController->state() == QLowEnergyController::UnconnectedState) dropController();
+}
+
+void BleSource::dropController()
+{
+    if (!bleController) return;
+
+    // Deleted later, as this may be running in one of its signals
+    bleController->deleteLater();
+    bleController = nullptr;
+    bleService = nullptr;
+    if (!stopped) rescanTimer->start();
+}
+
+void BleSource::onPingTimer()
+{
+    if (!bleService || !controlCharacteristic.isValid()) {
+        pingTimer->stop();
+        return;
+    }
+
+    bleService->writeCharacteristic(controlCharacteristic, clockSync.pingCommand(hostTime()));
+    if (++pingsSent == PING_BURST) pingTimer->setInterval(PING_INTERVAL_MS);
+    reportRejected();
+
+    if (clockSync.synchronized()) {
+        emit clockSynchronized(clockSync.drift(), clockSync.offset(), clockSync.roundTrip(),
+                               clockSync.exchanges());
+    }
+}
+
+void BleSource::processData(const QByteArray &data)
+{
+    double received = hostTime();
+
+    // Decode samples, skipping anything malformed
+    decodedSamples.clear();
+    if (!decoder.decode(data, decodedSamples)) return;
+
+    // Update the clock mapping from ping replies
+    pongs.clear();
+    decoder.takePongs(pongs);
+    for (const SampleDecoder::Pong &pong : pongs) {
+        clockSync.addPong(pong, received);
+    }
+
+    // Note whether the newest frame leaves a burst open. Retransmitted
+    // frames are usually older and leave it alone.
+    qint64 now = hostTimeMs();
+    lastReceived = now;
+    for (const SampleDecoder::Sample &sample : decodedSamples) {
+        if (sample.sequence < 0) continue;
+        if (sequenceSeen && qint16(quint16(sample.sequence - lastSequence)) <= 0) continue;
+        lastSequence = quint16(sample.sequence);
+        sequenceSeen = true;
+        tailOpen = sample.burst;
+    }
+
+    // Put samples back in order, requesting any frames that went missing
+    missingRanges.clear();
+    decoder.takeMissing(missingRanges);
+    sequencer.addMissing(missingRanges, now);
+    sequencer.add(decodedSamples, now);
+    requestMissing(now);
+    releaseSamples(now, received);
+    updateSequencerTimer();
+}
+
+void BleSource::onSequencerTimer()
+{
+    qint64 now = hostTimeMs();
+
+    // Ask once for the frames after a burst that went quiet. The device
+    // resends whichever of them it has, and ignores the rest.
+    if (tailOpen && now - lastReceived >= TAIL_WAIT_MS) {
+        tailOpen = false;
+        if (bleService && controlCharacteristic.isValid()) {
+            SampleDecoder::Range range = {quint16(lastSequence + 1), TAIL_REQUEST_FRAMES};
+            bleService->writeCharacteristic(controlCharacteristic, SampleSequencer::retransmitCommand(range));
+        }
+    }
+
+    requestMissing(now);
+    releaseSamples(now, hostTime());
+    updateSequencerTimer();
+}
+
+void BleSource::updateSequencerTimer()
+{
+    // Only runs while there is something to wait for
+    if (sequencer.idle() && !tailOpen) {
+        sequencerTimer->stop();
+    } else if (!sequencerTimer->isActive()) {
+        sequencerTimer->start();
+    }
+}
+
+void BleSource::releaseSamples(qint64 now, double received)
+{
+    orderedSamples.clear();
+    sequencer.release(orderedSamples, now);
+    if (sequencer.droppedFrames() != reportedDropped || sequencer.recoveredFrames() != reportedRecovered) {
+        reportedDropped = sequencer.droppedFrames();
+        reportedRecovered = sequencer.recoveredFrames();
+        emit linkStatsChanged(reportedDropped, reportedRecovered);
+    }
+    if (orderedSamples.isEmpty()) return;
+
+    // Place the samples on the host clock
+    if (clockSync.synchronized()) {
+        for (SampleDecoder::Sample &sample : orderedSamples) {
+            sample.hostTime = clockSync.toHost(sample.time);
+            receiveLatency.add(received - sample.hostTime);
+        }
+    }
+
+    emit samplesReceived(orderedSamples);
+}
+
+void BleSource::requestMissing(qint64 now)
+{
+    missingRanges.clear();
+    sequencer.takeRequests(missingRanges, now);
+    if (!bleService || !controlCharacteristic.isValid()) return;
+
+    for (const SampleDecoder::Range &range : missingRanges) {
+        bleService->writeCharacteristic(controlCharacteristic, SampleSequencer::retransmitCommand(range));
+    }
+}
+
+void BleSource::reportRejected()
+{
+    // At most once a ping, so a stream of bad rows cannot flood the log
+    if (decoder.rejectedRows() == reportedRejected) return;
+
+    emit statusMessage(QString("Rejected %1 CSV rows, the last one %2")
+                       .arg(decoder.rejectedRows() - reportedRejected)
+                       .arg(csvStatusText(decoder.lastRejection())));
+    reportedRejected = decoder.rejectedRows();
+}
+
+void BleSource::reportLatency()
+{
+    if (receiveLatency.count() > 0) {
+        emit statusMessage("Capture to receive latency:\n" + receiveLatency.report(10).trimmed());
+    }
+    receiveLatency.reset();
+}
@@ -0,0 +1,111 @@
+#ifndef BLESOURCE_H
+#define BLESOURCE_H
+
+#include <QTimer>
+#include <QVector>
+#include <QtBluetooth/QBluetoothDeviceDiscoveryAgent>
+#include <QtBluetooth/QLowEnergyController>
+#include <QtBluetooth/QLowEnergyService>
+#include <QtBluetooth/QLowEnergyCharacteristic>
+
+#include "clocksync.h"
+#include "datasource.h"
+#include "deviceconfig.h"
+#include "latencyhistogram.h"
+#include "sampledecoder.h"
+#include "samplesequencer.h"
+
+// The tamper over BLE: discovery, notifications, decoding, sequencing with
+// retransmit requests, clock sync and the device configuration. Connects to
+// the given device, or scans for the first one found if it is not valid, and
+// tries again whenever the device is lost, so it can be left unattended.
+class BleSource : public DataSource
+{
+    Q_OBJECT
+
+public:
+    BleSource(const QBluetoothDeviceInfo &device, QObject *parent = nullptr);
+    ~BleSource();
+
+    void start() override;
+    void stop() override;
+    void setTriggerLevels(double low, double high) override;
+    void writeDeviceConfig(const DeviceConfig &config) override;
+
+    // Whether a device found in a scan is a tamper
+    static bool isTamper(const QBluetoothDeviceInfo &info);
+
+private slots:
+    void onDeviceDiscovered(const QBluetoothDeviceInfo &info);
+    void onDeviceDiscoveryError(QBluetoothDeviceDiscoveryAgent::Error error);
+    void onDeviceDiscoveryFinished();
+    void startScan();
+    void onConnected();
+    void onDisconnected();
+    void onServiceDiscovered(const QBluetoothUuid &serviceUuid);
+    void onServiceDiscoveryFinished();
+    void onServiceStateChanged(QLowEnergyService::ServiceState newState);
+    void onCharacteristicChanged(const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue);
+    void onCharacteristicRead(const QLowEnergyCharacteristic &characteristic, const QByteArray &value);
+    void onCharacteristicWritten(const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue);
+    void onErrorOccurred(QLowEnergyController::Error error);
+    void onPingTimer();
+    void onSequencerTimer();
+
+private:
+    QBluetoothDeviceInfo device;
+
+    QBluetoothDeviceDiscoveryAgent *discoveryAgent;
+    QLowEnergyController *bleController;
+    QLowEnergyService *bleService;
+    QLowEnergyCharacteristic dataCharacteristic;
+    QLowEnergyCharacteristic controlCharacteristic;
+    QTimer *rescanTimer;
+    bool stopped;
+
+    DeviceConfig deviceConfig;
+    bool deviceConfigValid;
+
+    double triggerForceLow;
+    double triggerForceHigh;
+
+    SampleDecoder decoder;
+    QVector<SampleDecoder::Sample> decodedSamples;
+    quint32 reportedRejected;
+
+    // Samples in order, with lost frames requested again from the device
+    SampleSequencer sequencer;
+    QVector<SampleDecoder::Sample> orderedSamples;
+    QVector<SampleDecoder::Range> missingRanges;
+    quint32 reportedDropped;
+    quint32 reportedRecovered;
+
+    // Retries and give-ups fall due between notifications, and the tail of a
+    // burst can be lost with nothing after it to show the gap
+    QTimer *sequencerTimer;
+    qint64 lastReceived;  // host time of the last notification (ms)
+    quint16 lastSequence; // newest frame decoded
+    bool sequenceSeen;
+    bool tailOpen;        // the newest live frame was part of a burst
+
+    // Device to host clock mapping, kept up to date by regular pings
+    ClockSync clockSync;
+    QVector<SampleDecoder::Pong> pongs;
+    QTimer *pingTimer;
+    int pingsSent;
+
+    // Per-sample latency from capture on the device to receipt here
+    LatencyHistogram receiveLatency;
+
+    void connectDevice(const QBluetoothDeviceInfo &info);
+    void dropController();
+    void processData(const QByteArray &data);
+    void requestMissing(qint64 now);
+    void releaseSamples(qint64 now, double received);
+    void updateSequencerTimer();
+    void reportRejected();
+    void reportLatency();
+    void sendDeviceConfig();
+};
+
+#endif // BLESOURCE_H
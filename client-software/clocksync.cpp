@@ -0,0 +1,144 @@
+#include "clocksync.h"
+
+#include <algorithm>
+
+#include <QtEndian>
+
+#define CONTROL_PING 0x03
+
+// Exchanges kept for the fit, and pings awaiting a reply
+#define WINDOW_SIZE 32
+#define MAX_OUTSTANDING 16
+
+// Drift is only fitted once the exchanges span MIN_DRIFT_SPAN seconds, and
+// anything past MAX_DRIFT_PPM is taken to be noise
+#define MIN_DRIFT_SPAN 10.0
+#define MAX_DRIFT_PPM 1000.0
+
+ClockSync::ClockSync():
+    nextToken(0),
+    completed(0),
+    fitDevice(0),
+    fitOffset(0),
+    fitSlope(0),
+    bestRoundTrip(0)
+{
+}
+
+QByteArray ClockSync::pingCommand(double hostTime)
+{
+    // Forget the oldest pings if their replies were lost
+    while (outstanding.size() >= MAX_OUTSTANDING) outstanding.erase(outstanding.begin());
+
+    quint32 token = nextToken++;
+    outstanding.insert(token, hostTime);
+
+    QByteArray command(5, 0);
+    command[0] = CONTROL_PING;
+    qToLittleEndian<quint32>(token, command.data() + 1);
+    return command;
+}
+
+void ClockSync::addPong(const SampleDecoder::Pong &pong, double hostTime)
+{
+    auto ping = outstanding.find(pong.token);
+    if (ping == outstanding.end()) return;
+    double sent = ping.value();
+    outstanding.erase(ping);
+
+    // Offset is exact if the link is symmetric, and off by at most half
+    // the round trip if it is not
+    Exchange exchange;
+    exchange.deviceTime = (pong.receiveTime + pong.transmitTime) / 2;
+    exchange.offset = ((sent - pong.receiveTime) + (hostTime - pong.transmitTime)) / 2;
+    exchange.roundTrip = (hostTime - sent) - (pong.transmitTime - pong.receiveTime);
+
+    if (window.size() == WINDOW_SIZE) window.removeFirst();
+    window.push_back(exchange);
+    completed++;
+    fit();
+}
+
+bool ClockSync::synchronized() const
+{
+    return !window.isEmpty();
+}
+
+double ClockSync::toHost(double deviceTime) const
+{
+    return deviceTime + fitOffset + fitSlope * (deviceTime - fitDevice);
+}
+
+double ClockSync::offset() const
+{
+    if (window.isEmpty()) return 0;
+    return toHost(window.last().deviceTime) - window.last().deviceTime;
+}
+
+double ClockSync::drift() const
+{
+    return fitSlope * 1e6;
+}
+
+double ClockSync::roundTrip() const
+{
+    return bestRoundTrip;
+}
+
+int ClockSync::exchanges() const
+{
+    return completed;
+}
+
+void ClockSync::reset()
+{
+    outstanding.clear();
+    window.clear();
+    completed = 0;
+    fitDevice = 0;
+    fitOffset = 0;
+    fitSlope = 0;
+    bestRoundTrip = 0;
+}
+
+void ClockSync::fit()
+{
+    // Exchanges delayed on the way out or back are the least accurate, so
+    // only the better half by round trip is used
+    QVector<double> roundTrips;
+    for (const Exchange &exchange : window) roundTrips.push_back(exchange.roundTrip);
+    std::sort(roundTrips.begin(), roundTrips.end());
+    bestRoundTrip = roundTrips.first();
+    double cutoff = roundTrips[(roundTrips.size() - 1) / 2];
+
+    // Least squares line through offset against device time
+    int n = 0;
+    double sumDevice = 0;
+    double sumOffset = 0;
+    double first = 0;
+    double last = 0;
+    for (const Exchange &exchange : window) {
+        if (exchange.roundTrip > cutoff) continue;
+        if (n == 0) first = exchange.deviceTime;
+        last = exchange.deviceTime;
+        sumDevice += exchange.deviceTime;
+        sumOffset += exchange.offset;
+        n++;
+    }
+
+    fitDevice = sumDevice / n;
+    fitOffset = sumOffset / n;
+    fitSlope = 0;
+    if (last - first < MIN_DRIFT_SPAN) return;
+
+    double sxx = 0;
+    double sxy = 0;
+    for (const Exchange &exchange : window) {
+        if (exchange.roundTrip > cutoff) continue;
+        double dx = exchange.deviceTime - fitDevice;
+        sxx += dx * dx;
+        sxy += dx * (exchange.offset - fitOffset);
+    }
+
+    fitSlope = std::clamp(sxy / sxx, -MAX_DRIFT_PPM / 1e6, MAX_DRIFT_PPM / 1e6);
+}
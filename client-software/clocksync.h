@@ -0,0 +1,61 @@
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QVector>
+
+#include "sampledecoder.h"
+
+// Maps device time to host time from NTP-style ping exchanges over the
+// control characteristic. Each exchange gives the offset between the clocks
+// at the device time it happened, good to within half its round trip. The
+// estimate is a line fitted through the recent exchanges with the shortest
+// round trips, so its slope tracks the drift between the two crystals.
+class ClockSync
+{
+public:
+    ClockSync();
+
+    // Control characteristic command for a ping sent at hostTime (s)
+    QByteArray pingCommand(double hostTime);
+
+    // Add the device's reply to a ping, received at hostTime (s)
+    void addPong(const SampleDecoder::Pong &pong, double hostTime);
+
+    // True once at least one exchange has completed
+    bool synchronized() const;
+
+    // Host time (s) of a device time (s)
+    double toHost(double deviceTime) const;
+
+    double offset() const;    // host minus device time at the last exchange (s)
+    double drift() const;     // host clock rate relative to the device (ppm)
+    double roundTrip() const; // shortest recent round trip (s)
+    int exchanges() const;
+
+    void reset();
+
+private:
+    struct Exchange {
+        double deviceTime; // device time midway through the exchange
+        double offset;     // host minus device time
+        double roundTrip;  // time on the link, excluding the device turnaround
+    };
+
+    quint32 nextToken;
+    QMap<quint32, double> outstanding; // ping token to host send time
+
+    QVector<Exchange> window;
+    int completed;
+
+    // Fitted line: host = device + fitOffset + fitSlope * (device - fitDevice)
+    double fitDevice;
+    double fitOffset;
+    double fitSlope;
+    double bestRoundTrip;
+
+    void fit();
+};
+
+#endif // CLOCKSYNC_H
@@ -0,0 +1,59 @@
+#ifndef CSVPARSER_H
+#define CSVPARSER_H
+
+#include <charconv>
+#include <cstddef>
+
+// Result of parsing a row of comma-separated numbers
+enum CsvStatus {
+    CsvOk,
+    CsvColumnCount, // more or fewer columns than expected
+    CsvBadNumber,   // a column is empty or not a number
+};
+
+inline const char *csvStatusText(CsvStatus status)
+{
+    switch (status) {
+    case CsvOk: return "ok";
+    case CsvColumnCount: return "wrong number of columns";
+    case CsvBadNumber: return "not a number";
+    }
+    return "unknown";
+}
+
+inline bool isCsvSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Parse count numbers from one row straight out of the received bytes, with
+// no allocation. Whitespace and a line ending around each number and a
+// leading '+' are accepted, as QString::toDouble accepted them.
+inline CsvStatus parseCsvRow(const char *data, size_t size, double *values, int count)
+{
+    const char *end = data + size;
+
+    int commas = 0;
+    for (const char *c = data; c < end; c++) commas += *c == ',';
+    if (commas != count - 1) return CsvColumnCount;
+
+    const char *field = data;
+    for (int column = 0; column < count; column++) {
+        const char *fieldEnd = field;
+        while (fieldEnd < end && *fieldEnd != ',') fieldEnd++;
+
+        const char *first = field;
+        const char *last = fieldEnd;
+        while (first < last && isCsvSpace(*first)) first++;
+        while (last > first && isCsvSpace(last[-1])) last--;
+        if (last - first > 1 && first[0] == '+' && first[1] != '-') first++;
+
+        std::from_chars_result result = std::from_chars(first, last, values[column]);
+        if (result.ec != std::errc() || result.ptr != last) return CsvBadNumber;
+
+        field = fieldEnd + 1;
+    }
+    return CsvOk;
+}
+
+#endif // CSVPARSER_H
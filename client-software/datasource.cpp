@@ -0,0 +1,91 @@
+#include "datasource.h"
+
+#include "blesource.h"
+#include "replaysource.h"
+#include "serialsource.h"
+#include "syntheticsource.h"
+
+SourceOptions::SourceOptions():
+    kind(Ble),
+    stations(1),
+    baudRate(115200),
+    replaySpeed(1),
+    syntheticRate(80),
+    tampPeriod(3),
+    peakForce(15),
+    syntheticSeed(1)
+{
+}
+
+void addSourceOptions(QCommandLineParser &parser)
+{
+    parser.addOptions({
+        {"serial", "Read samples from a serial port instead of BLE.", "port"},
+        {"baud", "Serial port baud rate (default 115200).", "rate"},
+        {"replay", "Replay a saved trial file instead of BLE. Repeat for several.", "file"},
+        {"speed", "Replay speed, 1 to 1000 times real time (default 1).", "factor"},
+        {"synthetic", "Generate tamps instead of reading a device."},
+        {"rate", "Synthetic samples per second (default 80).", "hz"},
+        {"tamp-period", "Seconds between synthetic tamps (default 3).", "s"},
+        {"peak-kg", "Synthetic tamp force (default 15).", "kg"},
+        {"stations", "Record up to this many BLE tampers at once, or generate this many "
+                     "synthetic ones (default 1).", "count"},
+    });
+}
+
+bool sourceOptionsFromParser(const QCommandLineParser &parser, SourceOptions &options, QString &error)
+{
+    int chosen = parser.isSet("serial") + parser.isSet("replay") + parser.isSet("synthetic");
+    if (chosen > 1) {
+        error = "Choose one of --serial, --replay and --synthetic";
+        return false;
+    }
+
+    bool ok = true;
+    if (parser.isSet("stations")) {
+        options.stations = parser.value("stations").toInt(&ok);
+        if (!ok || options.stations < 1) {
+            error = "Invalid station count";
+            return false;
+        }
+        if (options.stations > 1 && (parser.isSet("serial") || parser.isSet("replay"))) {
+            error = "Only BLE and synthetic sources record several stations";
+            return false;
+        }
+    }
+
+    if (parser.isSet("serial")) {
+        options.kind = SourceOptions::Serial;
+        options.serialPort = parser.value("serial");
+        if (parser.isSet("baud")) options.baudRate = parser.value("baud").toInt(&ok);
+    } else if (parser.isSet("replay")) {
+        options.kind = SourceOptions::Replay;
+        options.replayFiles = parser.values("replay");
+        if (parser.isSet("speed")) options.replaySpeed = parser.value("speed").toDouble(&ok);
+    } else if (parser.isSet("synthetic")) {
+        options.kind = SourceOptions::Synthetic;
+        if (ok && parser.isSet("rate")) options.syntheticRate = parser.value("rate").toDouble(&ok);
+        if (ok && parser.isSet("tamp-period")) options.tampPeriod = parser.value("tamp-period").toDouble(&ok);
+        if (ok && parser.isSet("peak-kg")) options.peakForce = parser.value("peak-kg").toDouble(&ok);
+        ok &= options.syntheticRate > 0 && options.tampPeriod > 1 && options.peakForce > 0;
+    }
+
+    if (!ok) error = "Invalid source option value";
+    return ok;
+}
+
+DataSource *createDataSource(const SourceOptions &options, QObject *parent)
+{
+    switch (options.kind) {
+    case SourceOptions::Serial:
+        return new SerialSource(options.serialPort, options.baudRate, parent);
+    case SourceOptions::Replay:
+        return new ReplaySource(options.replayFiles, options.replaySpeed, parent);
+    case SourceOptions::Synthetic:
+        return new SyntheticSource(options.syntheticRate, options.tampPeriod, options.peakForce,
+                                   options.syntheticSeed, parent);
+    case SourceOptions::Ble:
+        break;
+    }
+    return new BleSource(options.bleDevice.value<QBluetoothDeviceInfo>(), parent);
+}
@@ -0,0 +1,87 @@
+#ifndef DATASOURCE_H
+#define DATASOURCE_H
+
+#include <QCommandLineParser>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#include "deviceconfig.h"
+#include "sampledecoder.h"
+
+// Where samples come from. Every source delivers them in order, in
+// batches, with host times filled in where the source knows them.
+class DataSource : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DataSource(QObject *parent = nullptr): QObject(parent) {}
+
+    // Start delivering samples, on the thread the source belongs to
+    virtual void start() = 0;
+    virtual void stop() = 0;
+
+    // Trigger levels for sources with a device that streams around them
+    virtual void setTriggerLevels(double low, double high) { Q_UNUSED(low); Q_UNUSED(high); }
+
+    // Configure the device, for sources that have one
+    virtual void writeDeviceConfig(const DeviceConfig &config) { Q_UNUSED(config); }
+
+signals:
+    void samplesReceived(const QVector<SampleDecoder::Sample> &samples);
+    void deviceConfigRead(const DeviceConfig &config);
+    void linkStatsChanged(quint32 dropped, quint32 recovered);
+    void clockSynchronized(double drift, double offset, double roundTrip, int exchanges);
+    void statusMessage(const QString &message);
+    void disconnected();
+
+    // The source cannot deliver samples and will not try again. Followed by
+    // disconnected.
+    void failed(const QString &message);
+};
+
+// Which source to read, and how, as given on the command line
+struct SourceOptions
+{
+    SourceOptions();
+
+    enum Kind {
+        Ble,
+        Serial,
+        Replay,
+        Synthetic,
+    };
+
+    Kind kind;
+
+    // Stations to record at once: tampers as they are found over BLE, or
+    // synthetic generators
+    int stations;
+
+    // A particular BLE device, rather than the first one found. Holds a
+    // QBluetoothDeviceInfo, so only BLE code needs the Bluetooth types.
+    QVariant bleDevice;
+
+    QString serialPort;
+    qint32 baudRate;
+
+    QStringList replayFiles; // trial CSV files, played one after another
+    double replaySpeed;      // 1 to 1000 times real time
+
+    double syntheticRate;    // samples per second
+    double tampPeriod;       // seconds from one synthetic tamp to the next (s)
+    double peakForce;        // synthetic tamp force (kg)
+    quint32 syntheticSeed;   // noise seed, different for each station
+};
+
+// Command line options choosing the source, BLE unless one is given
+void addSourceOptions(QCommandLineParser &parser);
+bool sourceOptionsFromParser(const QCommandLineParser &parser, SourceOptions &options, QString &error);
+
+// Create the source the options ask for
+DataSource *createDataSource(const SourceOptions &options, QObject *parent = nullptr);
+
+#endif // DATASOURCE_H
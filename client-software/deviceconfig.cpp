@@ -0,0 +1,102 @@
+#include "deviceconfig.h"
+
+#include <cstring>
+
+#include <QtEndian>
+
+#include "sampledecoder.h"
+
+#define CONFIG_VERSION 6
+#define CONFIG_SIZE 38
+
+#define CONTROL_SET_CONFIG 0x01
+
+static float floatFromLittleEndian(const char *data)
+{
+    quint32 bits = qFromLittleEndian<quint32>(data);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void floatToLittleEndian(float value, char *data)
+{
+    quint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    qToLittleEndian<quint32>(bits, data);
+}
+
+DeviceConfig::DeviceConfig():
+    averaging(1),
+    medianTaps(3),
+    filterOrder(1),
+    decimation(1),
+    batchSamples(32),
+    samplePeriod(0.05),
+    batchLatency(0.05),
+    displayRate(10),
+    heartbeatPeriod(1),
+    holdoffPeriod(0.25),
+    autoZeroBand(0),
+    armForce(0.1),
+    triggerForce(1.0),
+    countsPerKg(FORCE_COUNTS_PER_KG),
+    loadCells(1),
+    pretriggerFrames(64)
+{
+}
+
+bool DeviceConfig::fromBytes(const QByteArray &bytes, DeviceConfig &config)
+{
+    if (bytes.size() != CONFIG_SIZE || bytes[0] != CONFIG_VERSION) return false;
+
+    const char *data = bytes.constData();
+    config.averaging = quint8(data[1]);
+    config.medianTaps = quint8(data[2]);
+    config.filterOrder = quint8(data[3]);
+    config.decimation = quint8(data[4]);
+    config.batchSamples = qFromLittleEndian<quint16>(data + 5);
+    config.samplePeriod = qFromLittleEndian<quint32>(data + 7) / 1000000.;
+    config.batchLatency = qFromLittleEndian<quint32>(data + 11) / 1000000.;
+    config.displayRate = qFromLittleEndian<quint16>(data + 15);
+    config.heartbeatPeriod = qFromLittleEndian<quint16>(data + 17) / 1000.;
+    config.holdoffPeriod = qFromLittleEndian<quint16>(data + 19) / 1000.;
+    config.autoZeroBand = qFromLittleEndian<quint16>(data + 21) / 1000.;
+    config.armForce = floatFromLittleEndian(data + 23);
+    config.triggerForce = floatFromLittleEndian(data + 27);
+    config.countsPerKg = floatFromLittleEndian(data + 31);
+    config.loadCells = quint8(data[35]);
+    config.pretriggerFrames = qFromLittleEndian<quint16>(data + 36);
+    return true;
+}
+
+QByteArray DeviceConfig::toSetCommand() const
+{
+    QByteArray command(1 + CONFIG_SIZE, 0);
+    char *data = command.data() + 1;
+
+    command[0] = CONTROL_SET_CONFIG;
+    data[0] = CONFIG_VERSION;
+    data[1] = char(averaging);
+    data[2] = char(medianTaps);
+    data[3] = char(filterOrder);
+    data[4] = char(decimation);
+    qToLittleEndian<quint16>(batchSamples, data + 5);
+    qToLittleEndian<quint32>(qRound(samplePeriod * 1000000), data + 7);
+    qToLittleEndian<quint32>(qRound(batchLatency * 1000000), data + 11);
+    qToLittleEndian<quint16>(displayRate, data + 15);
+    qToLittleEndian<quint16>(qRound(heartbeatPeriod * 1000), data + 17);
+    qToLittleEndian<quint16>(qRound(holdoffPeriod * 1000), data + 19);
+    qToLittleEndian<quint16>(qRound(autoZeroBand * 1000), data + 21);
+    floatToLittleEndian(armForce, data + 23);
+    floatToLittleEndian(triggerForce, data + 27);
+    floatToLittleEndian(countsPerKg, data + 31);
+    data[35] = char(loadCells);
+    qToLittleEndian<quint16>(pretriggerFrames, data + 36);
+    return command;
+}
+
+bool DeviceConfig::isSetCommand(const QByteArray &command)
+{
+    return !command.isEmpty() && command[0] == CONTROL_SET_CONFIG;
+}
@@ -0,0 +1,40 @@
+#ifndef DEVICECONFIG_H
+#define DEVICECONFIG_H
+
+#include <QByteArray>
+#include <QMetaType>
+
+// Runtime configuration of the device, exchanged over the control
+// characteristic. See DeviceConfig in esp32-firmware/include/protocol.h.
+struct DeviceConfig
+{
+    DeviceConfig();
+
+    int averaging;          // length of each moving average stage (conversions)
+    int medianTaps;         // conversions in the spike filter median, 1 = off
+    int filterOrder;        // moving average stages
+    int decimation;         // conversions per sample during a burst
+    int batchSamples;       // max samples per notification
+    double samplePeriod;    // min time between samples at rest (s), 0 = every conversion
+    double batchLatency;    // max time a sample waits in a batch (s)
+    int displayRate;        // OLED refresh rate (Hz)
+    double heartbeatPeriod; // idle frame period (s)
+    double holdoffPeriod;   // time a burst continues after force drops below arm (s)
+    double autoZeroBand;    // band around zero that auto-zero tracks within (kg), 0 = off
+    double armForce;        // start/end of a full-rate burst (kg)
+    double triggerForce;    // force that marks an actual tamp (kg)
+    double countsPerKg;     // load cell calibration, read only
+    int loadCells;          // load cells fitted, 2 measures left/right balance, read only
+    int pretriggerFrames;   // idle frames sent ahead of a burst
+
+    // Parse the value read from the control characteristic
+    static bool fromBytes(const QByteArray &bytes, DeviceConfig &config);
+
+    // Control command that makes this the active configuration
+    QByteArray toSetCommand() const;
+    static bool isSetCommand(const QByteArray &command);
+};
+
+Q_DECLARE_METATYPE(DeviceConfig)
+
+#endif // DEVICECONFIG_H
@@ -0,0 +1,67 @@
+#include "devicescanner.h"
+
+#include "blesource.h"
+
+// Wait between scans
+#define RESCAN_DELAY_MS 5000
+
+DeviceScanner::DeviceScanner(QObject *parent):
+    QObject(parent),
+    discoveryAgent(new QBluetoothDeviceDiscoveryAgent(this)),
+    rescanTimer(new QTimer(this)),
+    stopped(true)
+{
+    rescanTimer->setSingleShot(true);
+    rescanTimer->setInterval(RESCAN_DELAY_MS);
+    connect(rescanTimer, &QTimer::timeout, this, &DeviceScanner::start);
+    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered, this, &DeviceScanner::onDeviceDiscovered);
+    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::errorOccurred, this, &DeviceScanner::onDiscoveryError);
+    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::finished, this, &DeviceScanner::onDiscoveryFinished);
+}
+
+void DeviceScanner::start()
+{
+    if (stopped) emit statusMessage("Scanning for BLE devices...");
+    stopped = false;
+    discoveryAgent->setLowEnergyDiscoveryTimeout(RESCAN_DELAY_MS);
+    discoveryAgent->start(QBluetoothDeviceDiscoveryAgent::LowEnergyMethod);
+}
+
+void DeviceScanner::stop()
+{
+    stopped = true;
+    rescanTimer->stop();
+    discoveryAgent->stop();
+}
+
+QString DeviceScanner::deviceName(const QBluetoothDeviceInfo &info)
+{
+    // The address, or on macOS, which hides addresses, the device UUID
+    QString name = info.address().isNull() ? info.deviceUuid().toString(QUuid::WithoutBraces)
+                                           : info.address().toString();
+    return name.remove(':').remove('-').toLower();
+}
+
+void DeviceScanner::onDeviceDiscovered(const QBluetoothDeviceInfo &info)
+{
+    if (stopped || !BleSource::isTamper(info)) return;
+
+    QString name = deviceName(info);
+    if (found.contains(name)) return;
+
+    found.insert(name);
+    emit statusMessage("Found BLE device: " + info.name() + " " + name);
+    emit deviceFound(info);
+}
+
+void DeviceScanner::onDiscoveryError(QBluetoothDeviceDiscoveryAgent::Error error)
+{
+    Q_UNUSED(error);
+    emit statusMessage("BLE device discovery error: " + discoveryAgent->errorString());
+    if (!stopped) rescanTimer->start();
+}
+
+void DeviceScanner::onDiscoveryFinished()
+{
+    if (!stopped) rescanTimer->start();
+}
@@ -0,0 +1,43 @@
+#ifndef DEVICESCANNER_H
+#define DEVICESCANNER_H
+
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <QtBluetooth/QBluetoothDeviceDiscoveryAgent>
+#include <QtBluetooth/QBluetoothDeviceInfo>
+
+// Scans for tampers over and over, reporting each one the first time it is
+// seen, so several stations can be connected as they are switched on. Each
+// station reconnects to its own device, so one seen before is not reported
+// again.
+class DeviceScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DeviceScanner(QObject *parent = nullptr);
+
+    void start();
+    void stop();
+
+    // A name for the device that stays the same from one run to the next
+    static QString deviceName(const QBluetoothDeviceInfo &info);
+
+signals:
+    void deviceFound(const QBluetoothDeviceInfo &info);
+    void statusMessage(const QString &message);
+
+private slots:
+    void onDeviceDiscovered(const QBluetoothDeviceInfo &info);
+    void onDiscoveryError(QBluetoothDeviceDiscoveryAgent::Error error);
+    void onDiscoveryFinished();
+
+private:
+    QBluetoothDeviceDiscoveryAgent *discoveryAgent;
+    QTimer *rescanTimer;
+    QSet<QString> found;
+    bool stopped;
+};
+
+#endif // DEVICESCANNER_H
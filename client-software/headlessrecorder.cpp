@@ -0,0 +1,150 @@
+#include "headlessrecorder.h"
+
+#include <csignal>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QSettings>
+
+// How often to check for a stop signal
+#define SIGNAL_POLL_MS 250
+
+// Set by the signal handler, which can do nothing more than this safely
+static volatile std::sig_atomic_t stopSignal = 0;
+
+static void onStopSignal(int signal)
+{
+    stopSignal = signal;
+}
+
+// Station name to start a log line with, when there are several
+static QString prefix(const Station *station)
+{
+    return station->name().isEmpty() ? QString() : station->name() + ": ";
+}
+
+HeadlessRecorder::HeadlessRecorder(const SourceOptions &options, QObject *parent):
+    QObject(parent),
+    options(options),
+    triggerForceLow(0.1),
+    triggerForceHigh(1.0),
+    logFolder("trials"),
+    scanner(nullptr),
+    trialsCompleted(0),
+    exitCode(0),
+    out(stdout),
+    signalTimer(nullptr)
+{
+    // Same settings as the GUI, so the two can share a trial folder
+    QSettings settings("QuantitativeCafe", "Tamper");
+    triggerForceLow = settings.value("triggerForce", triggerForceLow).toFloat();
+    triggerForceHigh = settings.value("triggerForceHigh", triggerForceHigh).toFloat();
+    logFolder = settings.value("logFolder", logFolder).toString();
+
+    log(QString("Recording to %1, trigger %2 / %3 kg")
+        .arg(QDir(logFolder).absolutePath()).arg(triggerForceHigh).arg(triggerForceLow));
+
+    // Several tampers as they are found, several generators, or one source
+    if (options.kind == SourceOptions::Ble && options.stations > 1) {
+        scanner = new DeviceScanner(this);
+        connect(scanner, &DeviceScanner::deviceFound, this, &HeadlessRecorder::onDeviceFound);
+        connect(scanner, &DeviceScanner::statusMessage, this, &HeadlessRecorder::log);
+        scanner->start();
+    } else if (options.stations > 1) {
+        for (int i = 1; i <= options.stations; i++) {
+            SourceOptions stationOptions = options;
+            stationOptions.syntheticSeed = i;
+            addStation("synthetic-" + QString::number(i), stationOptions);
+        }
+    } else {
+        addStation(QString(), options);
+    }
+
+    signalTimer = new QTimer(this);
+    connect(signalTimer, &QTimer::timeout, this, &HeadlessRecorder::onSignalTimer);
+    signalTimer->start(SIGNAL_POLL_MS);
+}
+
+HeadlessRecorder::~HeadlessRecorder()
+{
+    qDeleteAll(stations);
+    log(QString("Stopped, %1 trials recorded").arg(trialsCompleted));
+}
+
+void HeadlessRecorder::catchSignals()
+{
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+}
+
+void HeadlessRecorder::addStation(const QString &name, const SourceOptions &stationOptions)
+{
+    // Nothing plots the samples, so the station queues none
+    Station *station = new Station(name, stationOptions, false);
+    station->setLogFolder(logFolder);
+    station->setTriggerLevels(triggerForceLow, triggerForceHigh);
+    connect(station, &Station::trialCompleted, this, &HeadlessRecorder::onTrialCompleted);
+    connect(station, &Station::statusMessage, this, &HeadlessRecorder::log);
+    connect(station, &Station::disconnected, this, &HeadlessRecorder::onDisconnected);
+    connect(station, &Station::failed, this, &HeadlessRecorder::onFailed);
+    connect(station, &Station::deviceConfigRead, this, [this, station](const DeviceConfig &config) {
+        log(prefix(station) + QString("Device sampling every %1 ms, %2 load cells")
+                     .arg(config.samplePeriod * 1000).arg(config.loadCells));
+    });
+    connect(station, &Station::linkStatsChanged, this, [this, station](quint32 dropped, quint32 recovered) {
+        log(prefix(station) + QString("Frames dropped %1, recovered %2").arg(dropped).arg(recovered));
+    });
+
+    stations.append(station);
+    station->start();
+}
+
+void HeadlessRecorder::onDeviceFound(const QBluetoothDeviceInfo &info)
+{
+    SourceOptions stationOptions = options;
+    stationOptions.bleDevice = QVariant::fromValue(info);
+    addStation(DeviceScanner::deviceName(info), stationOptions);
+
+    // Each station reconnects to its own device from now on
+    if (stations.size() >= options.stations) {
+        scanner->stop();
+        log(QString("Recording %1 stations").arg(stations.size()));
+    }
+}
+
+void HeadlessRecorder::onTrialCompleted()
+{
+    trialsCompleted++;
+}
+
+void HeadlessRecorder::onDisconnected()
+{
+    // A replay has nothing more to give, nor has a source that failed; a
+    // device may come back
+    if (options.kind == SourceOptions::Replay || exitCode != 0) QCoreApplication::exit(exitCode);
+}
+
+void HeadlessRecorder::onFailed(const QString &message)
+{
+    log(message);
+    exitCode = 1;
+}
+
+void HeadlessRecorder::onSignalTimer()
+{
+    if (!stopSignal) return;
+
+    log(QString("Signal %1, stopping").arg(int(stopSignal)));
+    signalTimer->stop();
+    QCoreApplication::quit();
+}
+
+void HeadlessRecorder::log(const QString &message)
+{
+    // Timestamp each line of a multi-line message, so the log greps cleanly
+    QString stamp = QDateTime::currentDateTime().toString(Qt::ISODate);
+    for (const QString &line : message.split('\n')) {
+        out << stamp << " " << line << Qt::endl;
+    }
+}
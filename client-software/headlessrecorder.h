@@ -0,0 +1,56 @@
+#ifndef HEADLESSRECORDER_H
+#define HEADLESSRECORDER_H
+
+#include <QList>
+#include <QObject>
+#include <QTextStream>
+#include <QTimer>
+
+#include "datasource.h"
+#include "devicescanner.h"
+#include "station.h"
+
+// Records trials without a window, for unattended capture. Runs the same
+// stations as the GUI, with the same settings, and each writes its trials
+// as they complete. Status goes to stdout; SIGINT or SIGTERM stops it
+// cleanly, as does the end of a replay. A source that fails for good, such
+// as a replay that cannot be read or a serial port that is unplugged, exits
+// with status 1.
+class HeadlessRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HeadlessRecorder(const SourceOptions &options, QObject *parent = nullptr);
+    ~HeadlessRecorder();
+
+    // Catch SIGINT and SIGTERM, to quit the application when they arrive
+    static void catchSignals();
+
+private slots:
+    void onDeviceFound(const QBluetoothDeviceInfo &info);
+    void onTrialCompleted();
+    void onDisconnected();
+    void onFailed(const QString &message);
+    void onSignalTimer();
+    void log(const QString &message);
+
+private:
+    SourceOptions options;
+
+    double triggerForceLow;
+    double triggerForceHigh;
+    QString logFolder;
+
+    DeviceScanner *scanner;
+    QList<Station *> stations;
+    int trialsCompleted;
+    int exitCode;
+
+    QTextStream out;
+    QTimer *signalTimer;
+
+    void addStation(const QString &name, const SourceOptions &stationOptions);
+};
+
+#endif // HEADLESSRECORDER_H
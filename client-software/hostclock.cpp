@@ -0,0 +1,24 @@
+#include "hostclock.h"
+
+#include <QElapsedTimer>
+
+static const QElapsedTimer &hostClock()
+{
+    // Started the first time it is read; initializing a static is thread safe
+    static const QElapsedTimer clock = [] {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    return clock;
+}
+
+double hostTime()
+{
+    return hostClock().nsecsElapsed() / 1e9;
+}
+
+qint64 hostTimeMs()
+{
+    return hostClock().elapsed();
+}
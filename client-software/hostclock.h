@@ -0,0 +1,11 @@
+#ifndef HOSTCLOCK_H
+#define HOSTCLOCK_H
+
+#include <QtGlobal>
+
+// The host clock that sample host times are on. It is monotonic and there is
+// one for the whole process, so times taken on any thread or station compare.
+double hostTime();   // seconds since the clock started
+qint64 hostTimeMs(); // the same in whole milliseconds
+
+#endif // HOSTCLOCK_H
@@ -0,0 +1,188 @@
+#include "ingestworker.h"
+
+#include <algorithm>
+
+// Idle samples kept for trial detection before the old ones are dropped,
+// and the most kept of a load resting above the low trigger
+#define IDLE_TRIM_LENGTH 1024
+#define IDLE_KEEP_LENGTH 256
+
+IngestWorker::IngestWorker(IngestQueue *queue, const SourceOptions &options):
+    QObject(nullptr),
+    queue(queue),
+    options(options),
+    source(nullptr),
+    triggerForceLow(0.1),
+    triggerForceHigh(1.0),
+    triggered(false),
+    burstStart(0),
+    unplotted(0),
+    unplottedTrialEnd(false)
+{
+    qRegisterMetaType<TrialData>();
+    qRegisterMetaType<DeviceConfig>();
+}
+
+IngestWorker::~IngestWorker()
+{
+    stop();
+}
+
+void IngestWorker::start()
+{
+    // Created here so it belongs to the ingest thread
+    source = createDataSource(options, this);
+    source->setTriggerLevels(triggerForceLow, triggerForceHigh);
+    connect(source, &DataSource::samplesReceived, this, &IngestWorker::onSamplesReceived);
+    connect(source, &DataSource::deviceConfigRead, this, &IngestWorker::deviceConfigRead);
+    connect(source, &DataSource::linkStatsChanged, this, &IngestWorker::linkStatsChanged);
+    connect(source, &DataSource::clockSynchronized, this, &IngestWorker::clockSynchronized);
+    connect(source, &DataSource::statusMessage, this, &IngestWorker::statusMessage);
+    connect(source, &DataSource::disconnected, this, &IngestWorker::disconnected);
+    connect(source, &DataSource::failed, this, &IngestWorker::failed);
+    source->start();
+}
+
+void IngestWorker::stop()
+{
+    if (source) source->stop();
+}
+
+void IngestWorker::setTriggerLevels(double low, double high)
+{
+    triggerForceLow = low;
+    triggerForceHigh = high;
+    if (source) source->setTriggerLevels(low, high);
+}
+
+void IngestWorker::cancelTrial()
+{
+    triggered = false;
+    if (!queue) return;
+
+    // Mark the cancel in the stream, after the samples queued while the
+    // trial was on. If there is no room the next sample still carries it.
+    IngestSample item = {};
+    item.cancelled = true;
+    if (queue->samples.push(item) && !queue->signalled.exchange(true)) emit samplesReady();
+}
+
+void IngestWorker::writeDeviceConfig(const DeviceConfig &config)
+{
+    if (source) source->writeDeviceConfig(config);
+}
+
+void IngestWorker::onSamplesReceived(const QVector<SampleDecoder::Sample> &samples)
+{
+    for (const SampleDecoder::Sample &sample : samples) {
+        // Add to samples. The lead-in of a burst can be older than the
+        // heartbeats before it, so goes in by time.
+        int index = recentData.insertByTime(sample);
+        if (index <= burstStart && index < recentData.length() - 1) burstStart++;
+
+        // Note where the full-rate samples start
+        if (sample.rateChange && sample.burst) burstStart = index;
+
+        // Update trigger, which only looks at the latest samples
+        bool trialEnded = index == recentData.length() - 1 && updateTrigger();
+
+        if (!triggered) trimIdle();
+        if (queue) publish(sample, trialEnded);
+    }
+
+    // Wake the GUI unless it already has a drain on the way
+    if (queue && !queue->signalled.exchange(true)) emit samplesReady();
+}
+
+void IngestWorker::trimIdle()
+{
+    // A trial looks back no further than the last sample below the low
+    // trigger, so nothing before it is needed. A load resting between the
+    // triggers keeps only its latest samples. Dropped in blocks, so the
+    // samples between trials stay bounded however long the link is idle.
+    const int n = recentData.length();
+    if (n < IDLE_TRIM_LENGTH) return;
+
+    int start = n - 1;
+    while (start > n - IDLE_KEEP_LENGTH && recentData.force[start] >= triggerForceLow) --start;
+
+    recentData = recentData.mid(start);
+    burstStart = std::max(burstStart - start, 0);
+}
+
+bool IngestWorker::updateTrigger()
+{
+    // Check number of samples
+    int n = recentData.length();
+    if (n < 2) return false;
+
+    // Get last two samples
+    double y1 = recentData.force[n - 2];
+    double y2 = recentData.force[n - 1];
+
+    // Check start trigger condition
+    float a = (triggerForceHigh - y1) / (y2 - y1);
+    if (!triggered && (0 < a) && (a <= 1)) {
+        if (y2 > y1) {
+            // Set trigger
+            triggered = true;
+        }
+    }
+
+    // Check end trigger condition
+    a = (triggerForceLow - y1) / (y2 - y1);
+    if (triggered && (0 < a) && (a <= 1)) {
+        if (y1 > y2) {
+            // Clear trigger
+            triggered = false;
+
+            // Hand over the trial to be saved
+            return completeTrial();
+        }
+    }
+
+    return false;
+}
+
+bool IngestWorker::completeTrial()
+{
+    const int n = recentData.length();
+
+    // Look back to the last sample below the low trigger, but no further
+    // than the start of the burst
+    int start;
+    for (start = n - 2; start > burstStart; --start) {
+        if (recentData.force[start] < triggerForceLow) break;
+    }
+
+    // Return now if sample is too short
+    if (n - start < 5) return false;
+
+    emit trialCompleted(recentData.mid(start));
+
+    // Clear samples
+    recentData = recentData.mid(n - 1);
+    burstStart = 0;
+    return true;
+}
+
+void IngestWorker::publish(const SampleDecoder::Sample &sample, bool trialEnded)
+{
+    IngestSample item;
+    item.sample = sample;
+    item.triggered = triggered;
+    item.trialEnded = trialEnded || unplottedTrialEnd;
+    item.cancelled = false;
+
+    // Never wait for the GUI; a sample it has no room for is only lost to the plots
+    if (queue->samples.push(item)) {
+        unplottedTrialEnd = false;
+        if (unplotted > 0) {
+            emit statusMessage(QString("Plots fell behind, %1 samples not shown").arg(unplotted));
+            unplotted = 0;
+        }
+    } else {
+        unplotted++;
+        unplottedTrialEnd |= trialEnded;
+    }
+}
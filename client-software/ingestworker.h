@@ -0,0 +1,97 @@
+#ifndef INGESTWORKER_H
+#define INGESTWORKER_H
+
+#include <atomic>
+
+#include <QObject>
+#include <QVector>
+
+#include "datasource.h"
+#include "deviceconfig.h"
+#include "sampledecoder.h"
+#include "spscqueue.h"
+#include "trialdata.h"
+
+// A sample on its way to the plots, with the trial state after it
+struct IngestSample
+{
+    SampleDecoder::Sample sample;
+    bool triggered;  // a trial is in progress
+    bool trialEnded; // this sample ended a trial, which was handed over
+    bool cancelled;  // no sample, the trial in progress was cancelled here
+};
+
+#define INGEST_QUEUE_SIZE 4096
+
+// Samples from the ingest thread to the GUI thread. The ingest thread sends
+// samplesReady only when signalled was clear, and the GUI clears it before
+// draining, so nothing is left in the queue without a signal on the way.
+struct IngestQueue
+{
+    SpscQueue<IngestSample, INGEST_QUEUE_SIZE> samples;
+    std::atomic<bool> signalled{false};
+};
+
+// Reads a data source on a thread of its own and runs trial detection on
+// its samples. The GUI only reads the queue, so a slow replot or a dialog
+// never holds up the link. If the GUI falls behind, samples are left off the
+// plots but still reach the completed trials.
+class IngestWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    // queue may be null when nothing plots the samples
+    IngestWorker(IngestQueue *queue, const SourceOptions &options);
+    ~IngestWorker();
+
+public slots:
+    // Create and start the source, on the ingest thread
+    void start();
+    void stop();
+
+    void setTriggerLevels(double low, double high);
+    void cancelTrial();
+    void writeDeviceConfig(const DeviceConfig &config);
+
+signals:
+    void samplesReady();
+    void trialCompleted(const TrialData &trial);
+    void deviceConfigRead(const DeviceConfig &config);
+    void linkStatsChanged(quint32 dropped, quint32 recovered);
+    void clockSynchronized(double drift, double offset, double roundTrip, int exchanges);
+    void statusMessage(const QString &message);
+    void disconnected();
+    void failed(const QString &message);
+
+private slots:
+    void onSamplesReceived(const QVector<SampleDecoder::Sample> &samples);
+
+private:
+    IngestQueue *queue;
+    SourceOptions options;
+    DataSource *source;
+
+    double triggerForceLow;
+    double triggerForceHigh;
+
+    // Samples since the last trial, for trial detection
+    TrialData recentData;
+    bool triggered;
+
+    // Index in recentData of the first sample of the current burst. Samples
+    // before it are heartbeats, spaced far apart.
+    int burstStart;
+
+    // Samples the GUI had no room for since it last kept up, and whether
+    // one of them ended a trial
+    quint32 unplotted;
+    bool unplottedTrialEnd;
+
+    void trimIdle();
+    bool updateTrigger();
+    bool completeTrial();
+    void publish(const SampleDecoder::Sample &sample, bool trialEnded);
+};
+
+#endif // INGESTWORKER_H
@@ -0,0 +1,59 @@
+#include "latencyhistogram.h"
+
+#include <cmath>
+
+// One bin per millisecond up to MAX_LATENCY_MS, then overflow
+#define MAX_LATENCY_MS 1000
+
+LatencyHistogram::LatencyHistogram():
+    bins(MAX_LATENCY_MS + 1, 0),
+    total(0)
+{
+}
+
+void LatencyHistogram::add(double seconds)
+{
+    // Clock sync error can make very short latencies come out negative
+    int bin = qBound(0, int(std::floor(seconds * 1000)), MAX_LATENCY_MS);
+    bins[bin]++;
+    total++;
+}
+
+quint64 LatencyHistogram::count() const
+{
+    return total;
+}
+
+double LatencyHistogram::percentile(double p) const
+{
+    if (total == 0) return 0;
+
+    quint64 target = std::ceil(p * total);
+    quint64 seen = 0;
+    for (int i = 0; i < bins.size(); i++) {
+        seen += bins[i];
+        if (seen >= target) return i + 1;
+    }
+    return MAX_LATENCY_MS;
+}
+
+QString LatencyHistogram::report(int binMs) const
+{
+    QString text;
+    for (int first = 0; first < MAX_LATENCY_MS; first += binMs) {
+        quint64 n = 0;
+        for (int i = first; i < first + binMs && i < MAX_LATENCY_MS; i++) n += bins[i];
+        if (n == 0) continue;
+        text += QString("%1-%2 ms: %3\n").arg(first).arg(first + binMs).arg(n);
+    }
+    if (bins[MAX_LATENCY_MS] > 0) {
+        text += QString(">%1 ms: %2\n").arg(MAX_LATENCY_MS).arg(bins[MAX_LATENCY_MS]);
+    }
+    return text;
+}
+
+void LatencyHistogram::reset()
+{
+    bins.fill(0);
+    total = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QString>
+#include <QVector>
+
+// Counts latencies in one millisecond bins, with everything past the last
+// bin in an overflow bin
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void add(double seconds);
+
+    quint64 count() const;
+
+    // Latency (ms) that a fraction p of the samples are within
+    double percentile(double p) const;
+
+    // One line per non-empty range of binMs milliseconds
+    QString report(int binMs) const;
+
+    void reset();
+
+private:
+    QVector<quint64> bins;
+    quint64 total;
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -1,23 +1,59 @@
 #include "mainwindow.h"
 
+#include <cstdio>
+#include <cstring>
+
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QLocale>
+#include <QScopedPointer>
 #include <QTranslator>
 
+#include "datasource.h"
+#include "headlessrecorder.h"
+
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
+    // Record without a window, on a core application that needs no display
+    bool headless = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--headless")) headless = true;
+    }
+    QScopedPointer<QCoreApplication> a(headless ? new QCoreApplication(argc, argv)
+                                                : new QApplication(argc, argv));
 
     QTranslator translator;
     const QStringList uiLanguages = QLocale::system().uiLanguages();
     for (const QString &locale : uiLanguages) {
         const QString baseName = "gaspyc-2_" + QLocale(locale).name();
         if (translator.load(":/i18n/" + baseName)) {
-            a.installTranslator(&translator);
+            a->installTranslator(&translator);
             break;
         }
     }
-    MainWindow w;
+
+    // Read the device over BLE unless told to use another source
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Records tamping force and displacement.");
+    parser.addHelpOption();
+    parser.addOption({"headless", "Record trials without a window, logging to stdout."});
+    addSourceOptions(parser);
+    parser.process(*a);
+
+    SourceOptions options;
+    QString error;
+    if (!sourceOptionsFromParser(parser, options, error)) {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+
+    if (headless) {
+        HeadlessRecorder::catchSignals();
+        HeadlessRecorder recorder(options);
+        return a->exec();
+    }
+
+    MainWindow w(options);
     w.show();
-    return a.exec();
+    return a->exec();
 }
@@ -1,32 +1,25 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
-#include <algorithm>
-
 #include <QMessageBox>
 #include <QSettings>
+#include <QtMath>
 
 #include "optionsdialog.h"
 
-#define SERVICE_UUID        "6e400001-b5a3-f393-e0a9-e50e24dcca9e"
-#define CHARACTERISTIC_UUID "6e400002-b5a3-f393-e0a9-e50e24dcca9e"
+// Plots are redrawn at most this often, whatever the sample rates
+#define REPLOT_INTERVAL_MS 33
 
-MainWindow::MainWindow(QWidget *parent):
+MainWindow::MainWindow(const SourceOptions &options, QWidget *parent):
     QMainWindow(parent),
     ui(new Ui::MainWindow),
-    minDisplacement(1000),
-    maxDisplacement(-1000),
-    savedMinDisplacement(0),
-    savedMaxDisplacement(0),
-    discoveryAgent(new QBluetoothDeviceDiscoveryAgent(this)),
-    bleController(nullptr),
-    bleService(nullptr),
-    dataCharacteristic(),
+    options(options),
     triggerForceLow(0.1),
     triggerForceHigh(1.0),
-    triggered(false),
     logFolder("trials"),
-    trialNumber(1)
+    scanner(nullptr),
+    selected(nullptr),
+    replotTimer(nullptr)
 {
     ui->setupUi(this);
 
@@ -35,321 +28,221 @@ MainWindow::MainWindow(QWidget *parent):
     triggerForceLow = settings.value("triggerForce", triggerForceLow).toFloat();
     triggerForceHigh = settings.value("triggerForceHigh", triggerForceHigh).toFloat();
     logFolder = settings.value("logFolder", logFolder).toString();
-    trialNumber = settings.value("trialNumber", trialNumber).toInt();
-
-    // Initialize plot limits
-    maxForce = triggerForceLow;
-    savedMaxForce = triggerForceLow;
-
-    // Configure plots
-    liveCurve = configurePlot(ui->livePlot);
-    savedCurve = configurePlot(ui->savedPlot);
 
-    // Configure saved plot
-    ui->savedPlot->setBackground(QBrush(QColor(0, 0, 0, 0)));
-    ui->savedPlot->axisRect()->setBackground(QBrush(QColor(255, 255, 255, 255)));
-
-    // Configure BLE
-    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered, this, &MainWindow::onDeviceDiscovered);
-    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::errorOccurred, this, &MainWindow::onDeviceDiscoveryError);
-
-    ui->status->append("Scanning for BLE devices...");
-    discoveryAgent->start();
+    replotTimer = new QTimer(this);
+    connect(replotTimer, &QTimer::timeout, this, &MainWindow::onReplotTimer);
+    replotTimer->start(REPLOT_INTERVAL_MS);
+
+    // Several tampers as they are found, several generators, or one source
+    if (options.kind == SourceOptions::Ble && options.stations > 1) {
+        scanner = new DeviceScanner(this);
+        connect(scanner, &DeviceScanner::deviceFound, this, &MainWindow::onDeviceFound);
+        connect(scanner, &DeviceScanner::statusMessage, this, &MainWindow::onStatusMessage);
+        scanner->start();
+    } else if (options.stations > 1) {
+        for (int i = 1; i <= options.stations; i++) {
+            SourceOptions stationOptions = options;
+            stationOptions.syntheticSeed = i;
+            addStation("synthetic-" + QString::number(i), stationOptions);
+        }
+    } else {
+        addStation(QString(), options);
+    }
 
-    // Update filename
-    setTrialNumber(trialNumber);
+    updateInterface();
 }
 
 MainWindow::~MainWindow()
 {
-    if (bleController) {
-        bleController->disconnectFromDevice();
-        delete bleController;
-    }
-    delete discoveryAgent;
+    // Stop the stations before the panels plotting them go
+    for (StationPanel *panel : panels) delete panel->station();
     delete ui;
 }
 
-void MainWindow::onDeviceDiscovered(const QBluetoothDeviceInfo &device)
+void MainWindow::addStation(const QString &name, const SourceOptions &stationOptions)
 {
-    if (device.name().contains("ESP32_Tamper")) { // Replace with your BLE device name
-        ui->status->append("Found BLE device: " + device.name());
-        discoveryAgent->stop();
-
-        bleController = QLowEnergyController::createCentral(device, this);
-        connect(bleController, &QLowEnergyController::connected, this, &MainWindow::onConnected);
-        connect(bleController, &QLowEnergyController::errorOccurred, this, &MainWindow::onErrorOccurred);
-        connect(bleController, &QLowEnergyController::disconnected, this, &MainWindow::onDisconnected);
-        connect(bleController, &QLowEnergyController::serviceDiscovered, this, &MainWindow::onServiceDiscovered);
-        connect(bleController, &QLowEnergyController::discoveryFinished, this, &MainWindow::onServiceDiscoveryFinished);
-
-        ui->status->append("Connecting to BLE device...");
-        bleController->connectToDevice();
-    }
+    Station *station = new Station(name, stationOptions, true, this);
+    station->setLogFolder(logFolder);
+    station->setTriggerLevels(triggerForceLow, triggerForceHigh);
+
+    StationPanel *panel = new StationPanel(station, triggerForceLow, ui->stations);
+    connect(panel, &StationPanel::clicked, this, [this, panel] { select(panel); });
+    connect(panel, &StationPanel::triggerChanged, this, [this, panel] {
+        if (panel == selected) updateInterface();
+    });
+    connect(panel, &StationPanel::trialCompleted, this, [this, panel] {
+        if (panel == selected) updateInterface();
+    });
+    connect(panel, &StationPanel::statusMessage, this, &MainWindow::onStatusMessage);
+
+    connect(station, &Station::statusMessage, this, &MainWindow::onStatusMessage);
+    connect(station, &Station::failed, this, &MainWindow::onStatusMessage);
+    connect(station, &Station::trialNumberChanged, this, [this, panel] {
+        if (panel == selected) updateTrialNumber();
+    });
+    connect(station, &Station::linkStatsChanged, this, [this, panel] {
+        if (panel == selected) updateLinkStats();
+    });
+    connect(station, &Station::clockSynchronized, this,
+            [this, panel](double drift, double offset, double roundTrip, int exchanges) {
+        if (panel == selected) updateClockSync(drift, offset, roundTrip, exchanges);
+    });
+
+    panels.append(panel);
+    layoutPanels();
+    if (!selected) select(panel);
+
+    station->start();
 }
 
-void MainWindow::onDeviceDiscoveryError(QBluetoothDeviceDiscoveryAgent::Error error)
+void MainWindow::onDeviceFound(const QBluetoothDeviceInfo &info)
 {
-    Q_UNUSED(error);
-    ui->status->append("BLE device discovery error: " + discoveryAgent->errorString());
-}
-
-void MainWindow::onConnected()
-{
-    ui->status->append("Connected to BLE device");
-    bleController->discoverServices();
-}
-
-void MainWindow::onDisconnected()
-{
-    ui->status->append("Disconnected from BLE device");
-    bleService = nullptr;
-    dataCharacteristic = QLowEnergyCharacteristic();
-}
-
-void MainWindow::onServiceDiscovered(const QBluetoothUuid &serviceUuid)
-{
-    if (serviceUuid == QBluetoothUuid(QString(SERVICE_UUID))) {
-        ui->status->append("Found service: " + serviceUuid.toString());
-        bleService = bleController->createServiceObject(serviceUuid, this);
-        if (bleService) {
-            connect(bleService, &QLowEnergyService::stateChanged, this, &MainWindow::onServiceStateChanged);
-            connect(bleService, &QLowEnergyService::characteristicChanged, this, &MainWindow::onCharacteristicChanged);
-            bleService->discoverDetails();
-        }
+    SourceOptions stationOptions = options;
+    stationOptions.bleDevice = QVariant::fromValue(info);
+    addStation(DeviceScanner::deviceName(info), stationOptions);
+
+    // Each station reconnects to its own device from now on
+    if (panels.size() >= options.stations) {
+        scanner->stop();
+        onStatusMessage(QString("Recording %1 stations").arg(panels.size()));
     }
 }
 
-void MainWindow::onServiceDiscoveryFinished()
-{
-    ui->status->append("Service discovery finished");
-}
-
-void MainWindow::onServiceStateChanged(QLowEnergyService::ServiceState newState)
+void MainWindow::layoutPanels()
 {
-    if (newState == QLowEnergyService::RemoteServiceDiscovered) {
-        dataCharacteristic = bleService->characteristic(QBluetoothUuid(QString(CHARACTERISTIC_UUID)));
-        if (dataCharacteristic.isValid()) {
-            ui->status->append("Found data characteristic");
-            bleService->writeDescriptor(dataCharacteristic.descriptor(QBluetoothUuid(QString("00002902-0000-1000-8000-00805f9b34fb"))),
-                                        QByteArray::fromHex("0100")); // Enable notifications
-        }
+    // As square a grid as the stations allow, filled row by row
+    int columns = qCeil(qSqrt(panels.size()));
+    for (StationPanel *panel : panels) ui->stationGrid->removeWidget(panel);
+    for (int i = 0; i < panels.size(); i++) {
+        ui->stationGrid->addWidget(panels[i], i / columns, i % columns);
     }
-}
 
-void MainWindow::onCharacteristicChanged(const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue)
-{
-    if (characteristic.uuid() == QBluetoothUuid(QString(CHARACTERISTIC_UUID))) {
-        QString data = QString::fromUtf8(newValue);
-        processData(data);
-    }
+    // Highlight the selected station only when there is a choice
+    if (selected) selected->setSelected(panels.size() > 1);
 }
 
-void MainWindow::processData(const QString &data)
+void MainWindow::select(StationPanel *panel)
 {
-    QStringList cols = data.split(",");
-
-    // Skip if the wrong number of columns
-    if (cols.count() != 3) return;
-
-    // Get values
-    double time = cols[0].toDouble();
-    double force = cols[1].toDouble();
-    double displacement = cols[2].toDouble();
-
-    // Add to samples
-    liveData.time.push_back(time);
-    liveData.force.push_back(force);
-    liveData.displacement.push_back(displacement);
-
-    // Set current data
-    ui->currentTime->setText(QString::number(time, 'f', 1));
-    ui->currentForce->setText(QString::number(force, 'f', 3));
-    ui->currentDisplacement->setText(QString::number(displacement, 'f', 2));
-
-    // Update trigger
-    updateTrigger();
-
-    // Update plot limits
-    maxForce = std::max(maxForce, force);
-    minDisplacement = std::min(minDisplacement, displacement);
-    maxDisplacement = std::max(maxDisplacement, displacement);
-
-    // Update plots
-    updatePlots();
+    if (selected) selected->setSelected(false);
+    selected = panel;
+    selected->setSelected(panels.size() > 1);
+
+    // Clock sync is shown as the next report arrives
+    ui->clockDrift->clear();
+    ui->clockDrift->setToolTip(QString());
+    ui->latency->clear();
+    ui->latency->setToolTip(QString());
+
+    updateReadouts();
+    updateLinkStats();
+    updateTrialNumber();
+    updateInterface();
 }
 
-void MainWindow::onErrorOccurred(QLowEnergyController::Error error)
+void MainWindow::onReplotTimer()
 {
-    Q_UNUSED(error);
-    ui->status->append("BLE error: " + bleController->errorString());
+    for (StationPanel *panel : panels) {
+        if (panel->replot() && panel == selected) updateReadouts();
+    }
 }
 
-QCPCurve *MainWindow::configurePlot(QCustomPlot *plot)
+void MainWindow::onStatusMessage(const QString &message)
 {
-    plot->setBackground(QBrush(QColor(0, 0, 0, 0)));
-    plot->axisRect()->setBackground(QBrush(QColor(255, 255, 255, 255)));
-
-    QCPCurve *curve = new QCPCurve(plot->xAxis, plot->yAxis);
-    curve->setPen(QPen(QColor(40, 110, 255)));
-
-    plot->xAxis->setScaleType(QCPAxis::stLogarithmic);
-    QSharedPointer<QCPAxisTickerLog> logTicker(new QCPAxisTickerLog);
-    plot->xAxis->setTicker(logTicker);
-
-    plot->xAxis->setLabel("Force (kg)");
-    plot->yAxis->setLabel("Displacement (mm)");
-
-    plot->xAxis->setRange(triggerForceLow, maxForce);
-    plot->yAxis->setRange(minDisplacement, maxDisplacement);
-    plot->yAxis->setRangeReversed(true);
-
-    return curve;
+    ui->status->append(message);
 }
 
-void MainWindow::updateTrigger()
+void MainWindow::updateReadouts()
 {
-    // Check number of samples
-    int n = liveData.time.length();
-    if (n < 2) return;
-
-    // Get last two samples
-    double y1 = liveData.force[n - 2];
-    double y2 = liveData.force[n - 1];
-
-    // Check start trigger condition
-    float a = (triggerForceHigh - y1) / (y2 - y1);
-    if (!triggered && (0 < a) && (a <= 1)) {
-        if (y2 > y1) {
-            // Set trigger
-            triggered = true;
-
-            // Update interface
-            updateInterface();
-        }
+    if (!selected || !selected->hasSample()) {
+        ui->currentTime->clear();
+        ui->currentForce->clear();
+        ui->currentDisplacement->clear();
+        ui->currentBalance->clear();
+        return;
     }
 
-    // Check end trigger condition
-    a = (triggerForceLow - y1) / (y2 - y1);
-    if (triggered && (0 < a) && (a <= 1)) {
-        if (y1 > y2) {
-            // Save to disk
-            saveData();
-
-            // Clear trigger
-            triggered = false;
-
-            // Update interface
-            updateInterface();
-        }
-    }
+    // Set current data
+    const SampleDecoder::Sample &current = selected->currentSample();
+    ui->currentTime->setText(QString::number(current.time, 'f', 3));
+    ui->currentForce->setText(QString::number(current.force, 'f', 3));
+    ui->currentDisplacement->setText(QString::number(current.displacement, 'f', 2));
+    ui->currentBalance->setText(QString::number(current.balance, 'f', 3));
+    ui->currentBalance->setEnabled(selected->station()->deviceConfig().loadCells > 1);
 }
 
-void MainWindow::updatePlots()
+void MainWindow::updateLinkStats()
 {
-    // Set live data
-    liveCurve->setData(liveData.time, liveData.force, liveData.displacement);
-
-    // Set saved data
-    savedCurve->setData(savedData.time, savedData.force, savedData.displacement);
+    if (!selected) return;
 
-    // Update plot ranges
-    ui->livePlot->xAxis->setRange(triggerForceLow, maxForce);
-    ui->livePlot->yAxis->setRange(minDisplacement, maxDisplacement);
-
-    // Update plot ranges
-    ui->savedPlot->xAxis->setRange(triggerForceLow, savedMaxForce);
-    ui->savedPlot->yAxis->setRange(savedMinDisplacement, savedMaxDisplacement);
-
-    // Replot
-    ui->livePlot->replot();
-    ui->savedPlot->replot();
+    ui->droppedFrames->setText(QString::number(selected->station()->droppedFrames()));
+    ui->recoveredFrames->setText(QString::number(selected->station()->recoveredFrames()));
 }
 
-void MainWindow::saveData()
+void MainWindow::updateClockSync(double drift, double offset, double roundTrip, int exchanges)
 {
-    const int n = liveData.time.length();
-
-    int start;
-    for (start = n - 2; start > 0; --start) {
-        if (liveData.force[start] < triggerForceLow) break;
-    }
-
-    // Return now if sample is too short
-    if (n - start < 5) return;
-
-    // Copy everything since the trigger to saved data
-    savedData.time = liveData.time.mid(start);
-    savedData.force = liveData.force.mid(start);
-    savedData.displacement = liveData.displacement.mid(start);
-
-    // Write data to disk
-    writeData();
-
-    // Clear samples
-    liveData.time = liveData.time.mid(liveData.time.length() - 1);
-    liveData.force = liveData.force.mid(liveData.force.length() - 1);
-    liveData.displacement = liveData.displacement.mid(liveData.displacement.length() - 1);
-
-    // Update plot limits
-    savedMaxForce = triggerForceLow;
-    savedMinDisplacement = 1000;
-    savedMaxDisplacement = -1000;
-
-    for (int i = 0; i < savedData.time.length(); ++i) {
-        savedMaxForce = std::max(savedMaxForce, savedData.force[i]);
-        savedMinDisplacement = std::min(savedMinDisplacement, savedData.displacement[i]);
-        savedMaxDisplacement = std::max(savedMaxDisplacement, savedData.displacement[i]);
-    }
-
-    maxForce = triggerForceLow;
-    minDisplacement = 1000;
-    maxDisplacement = -1000;
-}
-
-void MainWindow::writeData()
-{
-    QFile file(ui->fileName->text());
-
-    if (file.open(QFile::WriteOnly | QFile::NewOnly)) {
-        QTextStream stream(&file);
-
-        stream << "time,force,displacement" << Qt::endl;
-
-        int n = savedData.time.length();
-        for (int i = 0; i < n; ++i) {
-            double time = savedData.time[i];
-            double force = savedData.force[i];
-            double displacement = savedData.displacement[i];
-
-            stream << QString::number(time, 'f', 1) << "," <<
-                      QString::number(force, 'f', 3) << "," <<
-                      QString::number(displacement, 'f', 2) << Qt::endl;
-        }
-
-        file.close();
-
-        // Increment trial number
-        setTrialNumber(trialNumber + 1);
-    } else {
-        QMessageBox::critical(this, tr("Error"), file.errorString());
-    }
+    ui->clockDrift->setText(QString::number(drift, 'f', 1));
+    ui->clockDrift->setToolTip(QString("Offset %1 s, best round trip %2 ms, %3 exchanges")
+                               .arg(offset, 0, 'f', 6)
+                               .arg(roundTrip * 1000, 0, 'f', 1)
+                               .arg(exchanges));
+
+    const LatencyHistogram &plotLatency = selected->latency();
+    if (plotLatency.count() == 0) return;
+    ui->latency->setText(QString("%1 / %2").arg(plotLatency.percentile(0.5))
+                                           .arg(plotLatency.percentile(0.99)));
+    ui->latency->setToolTip("Capture to plot:\n" + plotLatency.report(10).trimmed());
 }
 
 void MainWindow::on_options_clicked()
 {
     OptionsDialog dialog(this);
 
+    // Device settings are those of the selected station
+    DeviceConfig deviceConfig;
+    bool deviceConfigValid = selected && selected->station()->deviceConfigValid();
+    if (deviceConfigValid) deviceConfig = selected->station()->deviceConfig();
+
     // Copy current settings to dialog
     dialog.setTriggerForceLow(triggerForceLow);
     dialog.setTriggerForceHigh(triggerForceHigh);
     dialog.setLogFolder(logFolder);
+    dialog.setSamplePeriod(deviceConfig.samplePeriod * 1000);
+    dialog.setHoldoff(deviceConfig.holdoffPeriod * 1000);
+    dialog.setPretriggerFrames(deviceConfig.pretriggerFrames);
+    dialog.setAutoZeroBand(qRound(deviceConfig.autoZeroBand * 1000));
+    dialog.setAveraging(deviceConfig.averaging);
+    dialog.setMedianTaps(deviceConfig.medianTaps);
+    dialog.setFilterOrder(deviceConfig.filterOrder);
+    dialog.setDecimation(deviceConfig.decimation);
+    dialog.setBatchSize(deviceConfig.batchSamples);
+    dialog.setDisplayRate(deviceConfig.displayRate);
+    dialog.setAcquisitionEnabled(deviceConfigValid);
 
     if (dialog.exec()) {
-        // Update current settings
+        // Update current settings, which every station shares
         triggerForceLow = dialog.triggerForceLow();
         triggerForceHigh = dialog.triggerForceHigh();
         logFolder = dialog.logFolder();
+        for (StationPanel *panel : panels) {
+            panel->setTriggerForceLow(triggerForceLow);
+            panel->station()->setTriggerLevels(triggerForceLow, triggerForceHigh);
+            panel->station()->setLogFolder(logFolder);
+        }
+
+        // Update device settings
+        if (deviceConfigValid) {
+            deviceConfig.samplePeriod = dialog.samplePeriod() / 1000;
+            deviceConfig.holdoffPeriod = dialog.holdoff() / 1000;
+            deviceConfig.pretriggerFrames = dialog.pretriggerFrames();
+            deviceConfig.autoZeroBand = dialog.autoZeroBand() / 1000.;
+            deviceConfig.averaging = dialog.averaging();
+            deviceConfig.medianTaps = dialog.medianTaps();
+            deviceConfig.filterOrder = dialog.filterOrder();
+            deviceConfig.decimation = dialog.decimation();
+            deviceConfig.batchSamples = dialog.batchSize();
+            deviceConfig.displayRate = dialog.displayRate();
+            selected->station()->writeDeviceConfig(deviceConfig);
+        }
 
         // Update persistent settings
         QSettings settings("QuantitativeCafe", "Tamper");
@@ -358,57 +251,53 @@ void MainWindow::on_options_clicked()
         settings.setValue("logFolder", logFolder);
 
         // Update filename
-        setTrialNumber(trialNumber);
+        updateTrialNumber();
     }
 }
 
 void MainWindow::updateInterface()
 {
+    bool triggered = selected && selected->isTriggered();
     if (triggered) {
         ui->saveCancel->setText("Cancel");
         ui->saveCancel->setEnabled(true);
     } else {
         ui->saveCancel->setText("Save");
-        ui->saveCancel->setEnabled(!savedData.time.isEmpty());
+        ui->saveCancel->setEnabled(selected && !selected->savedTrial().isEmpty());
     }
 
-    ui->trialNumber->setEnabled(!triggered);
-    ui->fileName->setEnabled(!triggered);
+    ui->trialNumber->setEnabled(selected && !triggered);
+    ui->fileName->setEnabled(selected && !triggered);
 }
 
-void MainWindow::setTrialNumber(int val)
+void MainWindow::updateTrialNumber()
 {
-    // Update local value
-    trialNumber = val;
+    if (!selected) return;
 
     // Update UI
-    ui->trialNumber->setValue(trialNumber);
-    ui->fileName->setText(logFolder + "/trial-" + QString::number(trialNumber) + ".csv");
-
-    // Update persistent settings
-    QSettings settings("QuantitativeCafe", "Tamper");
-    settings.setValue("trialNumber", trialNumber);
+    ui->trialNumber->setValue(selected->station()->trialNumber());
+    ui->fileName->setText(selected->station()->fileName());
 }
 
 void MainWindow::on_saveCancel_clicked()
 {
-    if (triggered) {
+    if (!selected) return;
+
+    if (selected->isTriggered()) {
         // Clear trigger
-        triggered = false;
+        selected->cancelTrial();
 
         // Update interface
         updateInterface();
-
-        // Update plots
-        updatePlots();
     } else {
         // Write data to disk
-        writeData();
+        if (!selected->station()->saveTrial(selected->savedTrial())) {
+            QMessageBox::critical(this, tr("Error"), tr("Cannot write ") + selected->station()->fileName());
+        }
     }
-
 }
 
 void MainWindow::on_trialNumber_valueChanged(int value)
 {
-    setTrialNumber(value);
+    if (selected) selected->station()->setTrialNumber(value);
 }
@@ -1,15 +1,14 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QList>
 #include <QMainWindow>
-#include <QVector>
-#include <QtBluetooth/QBluetoothDeviceDiscoveryAgent>
-#include <QtBluetooth/QLowEnergyController>
-#include <QtBluetooth/QLowEnergyService>
-#include <QtBluetooth/QLowEnergyCharacteristic>
+#include <QTimer>
 
-class QCustomPlot;
-class QCPCurve;
+#include "datasource.h"
+#include "devicescanner.h"
+#include "station.h"
+#include "stationpanel.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -20,27 +19,13 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    explicit MainWindow(const SourceOptions &options, QWidget *parent = nullptr);
     ~MainWindow();
 
-    struct Data {
-        QVector<double> time;
-        QVector<double> force;
-        QVector<double> displacement;
-    };
-
-public slots:
-    void onDeviceDiscovered(const QBluetoothDeviceInfo &device);
-    void onDeviceDiscoveryError(QBluetoothDeviceDiscoveryAgent::Error error);
-    void onConnected();
-    void onDisconnected();
-    void onServiceDiscovered(const QBluetoothUuid &serviceUuid);
-    void onServiceDiscoveryFinished();
-    void onServiceStateChanged(QLowEnergyService::ServiceState newState);
-    void onCharacteristicChanged(const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue);
-    void onErrorOccurred(QLowEnergyController::Error error);
-
 private slots:
+    void onDeviceFound(const QBluetoothDeviceInfo &info);
+    void onReplotTimer();
+    void onStatusMessage(const QString &message);
     void on_options_clicked();
     void on_saveCancel_clicked();
     void on_trialNumber_valueChanged(int value);
@@ -48,40 +33,31 @@ private slots:
 private:
     Ui::MainWindow *ui;
 
-    double maxForce;
-    double minDisplacement;
-    double maxDisplacement;
-
-    double savedMaxForce;
-    double savedMinDisplacement;
-    double savedMaxDisplacement;
-
-    QBluetoothDeviceDiscoveryAgent *discoveryAgent;
-    QLowEnergyController *bleController;
-    QLowEnergyService *bleService;
-    QLowEnergyCharacteristic dataCharacteristic;
+    SourceOptions options;
 
     double triggerForceLow;
     double triggerForceHigh;
+    QString logFolder;
 
-    Data liveData;
-    Data savedData;
-
-    QCPCurve *liveCurve;
-    QCPCurve *savedCurve;
+    // Tampers found over BLE, when recording several at once
+    DeviceScanner *scanner;
 
-    bool triggered;
+    // One panel per station, in a grid. The controls and readouts are for
+    // the selected one.
+    QList<StationPanel *> panels;
+    StationPanel *selected;
 
-    QString logFolder;
-    int trialNumber;
+    // Every panel is redrawn on this timer, rather than as samples arrive,
+    // so the GUI does the same work however many stations there are
+    QTimer *replotTimer;
 
-    QCPCurve *configurePlot(QCustomPlot *plot);
-    void updateTrigger();
-    void updatePlots();
+    void addStation(const QString &name, const SourceOptions &stationOptions);
+    void layoutPanels();
+    void select(StationPanel *panel);
+    void updateReadouts();
+    void updateLinkStats();
+    void updateClockSync(double drift, double offset, double roundTrip, int exchanges);
     void updateInterface();
-    void saveData();
-    void writeData();
-    void setTrialNumber(int val);
-    void processData(const QString &data);
+    void updateTrialNumber();
 };
 #endif // MAINWINDOW_H
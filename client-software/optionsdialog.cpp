@@ -45,6 +45,112 @@ QString OptionsDialog::logFolder(void) const
     return ui->logFolder->text();
 }
 
+void OptionsDialog::setSamplePeriod(float ms)
+{
+    ui->samplePeriod->setText(QString::number(ms));
+}
+
+float OptionsDialog::samplePeriod() const
+{
+    return ui->samplePeriod->text().toFloat();
+}
+
+void OptionsDialog::setHoldoff(float ms)
+{
+    ui->holdoff->setText(QString::number(ms));
+}
+
+float OptionsDialog::holdoff() const
+{
+    return ui->holdoff->text().toFloat();
+}
+
+void OptionsDialog::setPretriggerFrames(int frames)
+{
+    ui->pretriggerFrames->setValue(frames);
+}
+
+int OptionsDialog::pretriggerFrames() const
+{
+    return ui->pretriggerFrames->value();
+}
+
+void OptionsDialog::setAutoZeroBand(int grams)
+{
+    ui->autoZeroBand->setValue(grams);
+}
+
+int OptionsDialog::autoZeroBand() const
+{
+    return ui->autoZeroBand->value();
+}
+
+void OptionsDialog::setAveraging(int count)
+{
+    ui->averaging->setValue(count);
+}
+
+int OptionsDialog::averaging() const
+{
+    return ui->averaging->value();
+}
+
+void OptionsDialog::setMedianTaps(int taps)
+{
+    ui->medianTaps->setValue(taps);
+}
+
+int OptionsDialog::medianTaps() const
+{
+    return ui->medianTaps->value();
+}
+
+void OptionsDialog::setFilterOrder(int order)
+{
+    ui->filterOrder->setValue(order);
+}
+
+int OptionsDialog::filterOrder() const
+{
+    return ui->filterOrder->value();
+}
+
+void OptionsDialog::setDecimation(int factor)
+{
+    ui->decimation->setValue(factor);
+}
+
+int OptionsDialog::decimation() const
+{
+    return ui->decimation->value();
+}
+
+void OptionsDialog::setBatchSize(int samples)
+{
+    ui->batchSize->setValue(samples);
+}
+
+int OptionsDialog::batchSize() const
+{
+    return ui->batchSize->value();
+}
+
+void OptionsDialog::setDisplayRate(int hz)
+{
+    ui->displayRate->setValue(hz);
+}
+
+int OptionsDialog::displayRate() const
+{
+    return ui->displayRate->value();
+}
+
+void OptionsDialog::setAcquisitionEnabled(bool enabled)
+{
+    // Acquisition settings live on the device, so need a connection
+    ui->acquisitionGroup->setEnabled(enabled);
+}
+
 void OptionsDialog::on_chooseLogFolder_clicked()
 {
     // Pick a folder
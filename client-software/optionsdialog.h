@@ -26,6 +26,38 @@ public:
     void setLogFolder(const QString &folder);
     QString logFolder() const;
 
+    void setSamplePeriod(float ms);
+    float samplePeriod() const;
+
+    void setHoldoff(float ms);
+    float holdoff() const;
+
+    void setPretriggerFrames(int frames);
+    int pretriggerFrames() const;
+
+    void setAutoZeroBand(int grams);
+    int autoZeroBand() const;
+
+    void setAveraging(int count);
+    int averaging() const;
+
+    void setMedianTaps(int taps);
+    int medianTaps() const;
+
+    void setFilterOrder(int order);
+    int filterOrder() const;
+
+    void setDecimation(int factor);
+    int decimation() const;
+
+    void setBatchSize(int samples);
+    int batchSize() const;
+
+    void setDisplayRate(int hz);
+    int displayRate() const;
+
+    void setAcquisitionEnabled(bool enabled);
+
 private slots:
     void on_chooseLogFolder_clicked();
 
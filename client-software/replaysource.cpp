@@ -0,0 +1,136 @@
+#include "replaysource.h"
+
+#include <QFile>
+#include <QtGlobal>
+
+#include "csvparser.h"
+#include "hostclock.h"
+
+#define REPLAY_TICK_MS 10
+
+// Time between the end of one file and the start of the next (s)
+#define REPLAY_GAP 1.0
+
+#define MAX_COLUMNS 8
+
+ReplaySource::ReplaySource(const QStringList &files, double speed, QObject *parent):
+    DataSource(parent),
+    files(files),
+    speed(qBound(1.0, speed, 1000.0)),
+    timer(nullptr),
+    next(0),
+    startHost(0)
+{
+}
+
+void ReplaySource::start()
+{
+    // Nothing to play is an error, so a headless replay ends rather than waits
+    for (const QString &fileName : files) {
+        if (!load(fileName)) {
+            emit disconnected();
+            return;
+        }
+    }
+    if (recorded.isEmpty()) {
+        emit failed("No samples to replay in " + files.join(", "));
+        emit disconnected();
+        return;
+    }
+    emit statusMessage(QString("Replaying %1 samples from %2 files at %3x")
+                       .arg(recorded.size()).arg(files.size()).arg(speed));
+
+    timer = new QTimer(this);
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, &QTimer::timeout, this, &ReplaySource::onTick);
+    next = 0;
+    startHost = hostTime();
+    timer->start(REPLAY_TICK_MS);
+}
+
+void ReplaySource::stop()
+{
+    if (timer) timer->stop();
+}
+
+bool ReplaySource::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly)) {
+        emit failed("Cannot open " + fileName + ": " + file.errorString());
+        return false;
+    }
+
+    // Find the columns from the header, as older files have fewer
+    QList<QByteArray> header = file.readLine().trimmed().split(',');
+    int count = qMin(int(header.size()), MAX_COLUMNS);
+    int timeColumn = header.indexOf("time");
+    int forceColumn = header.indexOf("force");
+    int displacementColumn = header.indexOf("displacement");
+    int displacementTimeColumn = header.indexOf("displacement_time");
+    int balanceColumn = header.indexOf("balance");
+    if (timeColumn < 0 || forceColumn < 0 || displacementColumn < 0 || count != header.size()) {
+        emit failed("Not a trial file: " + fileName);
+        return false;
+    }
+
+    // Follow on from the previous file
+    double offset = 0;
+    bool first = true;
+    double previousEnd = recorded.isEmpty() ? 0 : recorded.last().time + REPLAY_GAP;
+
+    int rejected = 0;
+    char line[256];
+    qint64 length;
+    while ((length = file.readLine(line, sizeof(line))) > 0) {
+        double values[MAX_COLUMNS];
+        if (parseCsvRow(line, size_t(length), values, count) != CsvOk) {
+            rejected++;
+            continue;
+        }
+
+        if (first) {
+            offset = previousEnd - values[timeColumn];
+            first = false;
+        }
+
+        SampleDecoder::Sample sample;
+        sample.time = values[timeColumn] + offset;
+        sample.force = values[forceColumn];
+        sample.balance = balanceColumn >= 0 ? values[balanceColumn] : 0;
+        sample.displacement = values[displacementColumn];
+        sample.displacementTime = displacementTimeColumn >= 0 ? values[displacementTimeColumn] + offset
+                                                              : sample.time;
+        sample.sequence = -1;
+        sample.burst = false;
+        sample.rateChange = false;
+        sample.hostTime = 0;
+        recorded.push_back(sample);
+    }
+
+    if (rejected > 0) {
+        emit statusMessage(QString("Skipped %1 malformed rows in %2").arg(rejected).arg(fileName));
+    }
+    return true;
+}
+
+void ReplaySource::onTick()
+{
+    // Everything recorded up to the current playback position
+    double firstTime = recorded.first().time;
+    double playTime = firstTime + (hostTime() - startHost) * speed;
+
+    batch.clear();
+    while (next < recorded.size() && recorded[next].time <= playTime) {
+        SampleDecoder::Sample sample = recorded[next++];
+        sample.hostTime = startHost + (sample.time - firstTime) / speed;
+        batch.push_back(sample);
+    }
+    if (!batch.isEmpty()) emit samplesReceived(batch);
+
+    if (next == recorded.size()) {
+        timer->stop();
+        emit statusMessage("Replay finished");
+        emit disconnected();
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef REPLAYSOURCE_H
+#define REPLAYSOURCE_H
+
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+#include "datasource.h"
+#include "sampledecoder.h"
+
+// Saved trial-N.csv files streamed again at their recorded timing, sped up
+// by 1 to 1000 times, one file after another. Host times are the times
+// each sample is due, so latency through the client can be measured.
+class ReplaySource : public DataSource
+{
+    Q_OBJECT
+
+public:
+    ReplaySource(const QStringList &files, double speed, QObject *parent = nullptr);
+
+    void start() override;
+    void stop() override;
+
+private slots:
+    void onTick();
+
+private:
+    QStringList files;
+    double speed;
+    QTimer *timer;
+
+    QVector<SampleDecoder::Sample> recorded;
+    QVector<SampleDecoder::Sample> batch;
+    int next;          // index in recorded of the next sample due
+    double startHost;  // host time playback started (s)
+
+    bool load(const QString &fileName);
+};
+
+#endif // REPLAYSOURCE_H
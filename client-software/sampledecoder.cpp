@@ -0,0 +1,316 @@
+#include "sampledecoder.h"
+
+#include <QtEndian>
+
+// Binary sample frame layout, see SampleFrame in esp32-firmware/include/protocol.h.
+// Version 1 frames lack the caliper time offset and version 2 frames the
+// balance. Frames of versions 3 to 7 share their first byte with packets
+// and are not accepted.
+#define PROTOCOL_VERSION 8
+#define FRAME_SIZE_V1 16
+#define FRAME_SIZE_V2 20
+#define FRAME_SIZE 24
+
+#define FRAME_FLAG_CALIPER_VALID 0x01
+#define FRAME_FLAG_STREAMING     0x08
+#define FRAME_FLAG_RATE_CHANGE   0x20
+
+// Delta-compressed packets, see PACKET_VERSION_DELTA in protocol.h. Versions
+// 3 and 4 are the same packets from firmware without the balance value.
+#define PACKET_VERSION_DELTA_V1 3
+#define PACKET_VERSION_RETRANSMIT_V1 4
+#define PACKET_VERSION_DELTA 6
+#define PACKET_VERSION_RETRANSMIT 7
+#define PACKET_HEADER_SIZE 3
+#define RECORD_VALUES_V1 4
+#define RECORD_VALUES 5
+
+// Clock sync ping reply, see PongPacket in protocol.h
+#define PACKET_VERSION_PONG 5
+#define PONG_SIZE 13
+
+#define RECORD_FLAGS_MASK 0x3f
+#define RECORD_SKIP       0x40
+#define RECORD_KEYFRAME   0x80
+
+static qint32 zigzagDecode(quint32 value)
+{
+    return qint32((value >> 1) ^ (0u - (value & 1)));
+}
+
+// Read a little-endian base 128 varint, advancing pos
+static bool readVarint(const QByteArray &data, int &pos, quint32 &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35 && pos < data.size(); shift += 7) {
+        quint8 byte = data[pos++];
+        value |= quint32(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+SampleDecoder::SampleDecoder():
+    forceCountsPerKg(FORCE_COUNTS_PER_KG),
+    lastTime(0),
+    timeValid(false),
+    live(),
+    resent(),
+    rejected(0),
+    rejection(CsvOk)
+{
+}
+
+void SampleDecoder::setCountsPerKg(double counts)
+{
+    forceCountsPerKg = counts;
+}
+
+double SampleDecoder::countsPerKg() const
+{
+    return forceCountsPerKg;
+}
+
+bool SampleDecoder::decode(const QByteArray &payload, QVector<Sample> &samples)
+{
+    if (payload.isEmpty()) return false;
+
+    // Binary frames start with the protocol version, which is never printable.
+    // A notification carries one or more frames back to back.
+    int version = payload[0];
+    if (version == PACKET_VERSION_DELTA) return decodeDelta(payload, RECORD_VALUES, live, samples);
+    if (version == PACKET_VERSION_DELTA_V1) {
+        return decodeDelta(payload, RECORD_VALUES_V1, live, samples);
+    }
+    if (version == PACKET_VERSION_RETRANSMIT || version == PACKET_VERSION_RETRANSMIT_V1) {
+        // Every retransmitted packet starts with a keyframe
+        resent.synced = false;
+        int valueCount = version == PACKET_VERSION_RETRANSMIT ? RECORD_VALUES : RECORD_VALUES_V1;
+        return decodeDelta(payload, valueCount, resent, samples);
+    }
+    if (version == PACKET_VERSION_PONG) return decodePong(payload);
+
+    int frameSize = 0;
+    if (version == 1) frameSize = FRAME_SIZE_V1;
+    if (version == 2) frameSize = FRAME_SIZE_V2;
+    if (version == PROTOCOL_VERSION) frameSize = FRAME_SIZE;
+
+    if (frameSize > 0 && payload.size() % frameSize == 0) {
+        for (int i = 0; i < payload.size(); i += frameSize) {
+            if (payload[i] != version) return false;
+            decodeFrame(payload.constData() + i, version, samples);
+        }
+        return true;
+    }
+
+    return decodeCsv(payload, samples);
+}
+
+void SampleDecoder::takeMissing(QVector<Range> &ranges)
+{
+    ranges += missing;
+    missing.clear();
+}
+
+void SampleDecoder::takePongs(QVector<Pong> &replies)
+{
+    replies += pongs;
+    pongs.clear();
+}
+
+quint32 SampleDecoder::rejectedRows() const
+{
+    return rejected;
+}
+
+CsvStatus SampleDecoder::lastRejection() const
+{
+    return rejection;
+}
+
+void SampleDecoder::reset()
+{
+    lastTime = 0;
+    timeValid = false;
+    live = DeltaState();
+    resent = DeltaState();
+    missing.clear();
+    pongs.clear();
+    rejected = 0;
+    rejection = CsvOk;
+}
+
+qint64 SampleDecoder::unwrapTime(quint32 timestamp)
+{
+    // Unwrap a 32-bit microsecond timestamp. Retransmitted frames can be
+    // older than the newest one seen, so take the nearest match.
+    qint64 time = timestamp;
+    if (timeValid) time = lastTime + qint32(timestamp - quint32(lastTime));
+    if (!timeValid || time > lastTime) lastTime = time;
+    timeValid = true;
+    return time;
+}
+
+bool SampleDecoder::decodePong(const QByteArray &payload)
+{
+    if (payload.size() != PONG_SIZE) return false;
+
+    const char *data = payload.constData();
+    Pong pong;
+    pong.token = qFromLittleEndian<quint32>(data + 1);
+    pong.receiveTime = unwrapTime(qFromLittleEndian<quint32>(data + 5)) / 1000000.;
+    pong.transmitTime = unwrapTime(qFromLittleEndian<quint32>(data + 9)) / 1000000.;
+    pongs.push_back(pong);
+    return true;
+}
+
+bool SampleDecoder::decodeDelta(const QByteArray &payload, int valueCount, DeltaState &state,
+                                QVector<Sample> &samples)
+{
+    if (payload.size() < PACKET_HEADER_SIZE) return false;
+
+    // Differences only follow on from the previous packet if none was missed
+    quint16 sequence = qFromLittleEndian<quint16>(payload.constData() + 1);
+    if (state.started && sequence != state.sequence) {
+        state.synced = false;
+
+        // Anything far off is a restarted stream rather than a loss
+        quint16 gap = sequence - state.sequence;
+        if (&state == &live && gap < 0x8000) addMissing(state.sequence, gap);
+    }
+    state.started = true;
+
+    int pos = PACKET_HEADER_SIZE;
+    while (pos < payload.size()) {
+        quint8 header = payload[pos++];
+        quint32 skipped = 0;
+        quint32 values[RECORD_VALUES] = {};
+        if ((header & RECORD_SKIP) && !readVarint(payload, pos, skipped)) return false;
+        for (int i = 0; i < valueCount; i++) {
+            if (!readVarint(payload, pos, values[i])) return false;
+        }
+
+        // Skipped frames were dropped on the device and never sent
+        sequence += skipped;
+
+        quint32 timestamp;
+        qint32 forceCounts;
+        quint32 caliperWord;
+        quint32 caliperTime;
+        qint32 balanceCounts;
+        if (header & RECORD_KEYFRAME) {
+            timestamp = values[0];
+            forceCounts = zigzagDecode(values[1]);
+            caliperWord = values[2];
+            caliperTime = timestamp + zigzagDecode(values[3]);
+            balanceCounts = zigzagDecode(values[4]);
+            state.timestamp = timestamp;
+            state.interval = 0;
+            state.synced = true;
+        } else if (state.synced) {
+            timestamp = state.timestamp + state.interval + zigzagDecode(values[0]);
+            forceCounts = qint32(quint32(state.forceCounts) + zigzagDecode(values[1]));
+            caliperWord = state.caliperWord + zigzagDecode(values[2]);
+            caliperTime = state.caliperTime + zigzagDecode(values[3]);
+            balanceCounts = qint32(quint32(state.balanceCounts) + zigzagDecode(values[4]));
+        } else {
+            if (&state == &live) addMissing(sequence, 1);
+            sequence++;
+            continue;
+        }
+
+        state.interval = timestamp - state.timestamp;
+        state.timestamp = timestamp;
+        state.forceCounts = forceCounts;
+        state.caliperWord = caliperWord;
+        state.caliperTime = caliperTime;
+        state.balanceCounts = balanceCounts;
+
+        addSample(sequence++, header & RECORD_FLAGS_MASK, timestamp, forceCounts, caliperWord,
+                  qint32(caliperTime - timestamp), balanceCounts, samples);
+    }
+
+    state.sequence = sequence;
+    return true;
+}
+
+bool SampleDecoder::decodeFrame(const char *frame, int version, QVector<Sample> &samples)
+{
+    quint8 flags = frame[1];
+    quint16 sequence = qFromLittleEndian<quint16>(frame + 2);
+    quint32 timestamp = qFromLittleEndian<quint32>(frame + 4);
+    qint32 forceCounts = qFromLittleEndian<qint32>(frame + 8);
+    quint32 caliperWord = qFromLittleEndian<quint32>(frame + 12);
+    qint32 caliperOffset = version >= 2 ? qFromLittleEndian<qint32>(frame + 16) : 0;
+    qint32 balanceCounts = version >= PROTOCOL_VERSION ? qFromLittleEndian<qint32>(frame + 20) : 0;
+
+    addSample(sequence, flags, timestamp, forceCounts, caliperWord, caliperOffset, balanceCounts, samples);
+    return true;
+}
+
+void SampleDecoder::addSample(int sequence, quint8 flags, quint32 timestamp, qint32 forceCounts,
+                              quint32 caliperWord, qint32 caliperOffset, qint32 balanceCounts,
+                              QVector<Sample> &samples)
+{
+    qint64 time = unwrapTime(timestamp);
+
+    Sample sample;
+    sample.time = time / 1000000.;
+    sample.force = forceCounts / forceCountsPerKg;
+    sample.balance = balanceCounts / forceCountsPerKg;
+    sample.displacement = 0;
+    sample.displacementTime = sample.time + caliperOffset / 1000000.;
+    sample.sequence = sequence;
+    sample.burst = flags & FRAME_FLAG_STREAMING;
+    sample.rateChange = flags & FRAME_FLAG_RATE_CHANGE;
+    sample.hostTime = 0;
+
+    // Bits 0-19 hold hundredths of a millimetre, bit 20 is the sign
+    if (flags & FRAME_FLAG_CALIPER_VALID) {
+        sample.displacement = (caliperWord & ~(15u << 20)) / 100.;
+        if (caliperWord & (1u << 20)) sample.displacement = -sample.displacement;
+    }
+
+    samples.push_back(sample);
+}
+
+void SampleDecoder::addMissing(quint16 first, quint16 count)
+{
+    if (count == 0) return;
+
+    // Extend the last range where possible, so a lost stretch is one request
+    if (!missing.isEmpty() && quint16(missing.last().first + missing.last().count) == first) {
+        missing.last().count += count;
+    } else {
+        missing.push_back({first, count});
+    }
+}
+
+bool SampleDecoder::decodeCsv(const QByteArray &payload, QVector<Sample> &samples)
+{
+    // Parse in place, counting rows that are not three or four numbers. The
+    // fourth, from the serial port, is the balance.
+    double values[4] = {0, 0, 0, 0};
+    int columns = payload.count(',') == 3 ? 4 : 3;
+    CsvStatus status = parseCsvRow(payload.constData(), payload.size(), values, columns);
+    if (status != CsvOk) {
+        rejected++;
+        rejection = status;
+        return false;
+    }
+
+    // Get values
+    Sample sample;
+    sample.time = values[0];
+    sample.force = values[1];
+    sample.balance = values[3];
+    sample.displacement = values[2];
+    sample.displacementTime = sample.time;
+    sample.sequence = -1;
+    sample.burst = false;
+    sample.rateChange = false;
+    sample.hostTime = 0;
+
+    samples.push_back(sample);
+    return true;
+}
@@ -0,0 +1,105 @@
+#ifndef SAMPLEDECODER_H
+#define SAMPLEDECODER_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include "csvparser.h"
+
+// Load cell calibration used by the firmware (HX711 counts per kg)
+#define FORCE_COUNTS_PER_KG (57300 / 0.546)
+
+class SampleDecoder
+{
+public:
+    SampleDecoder();
+
+    struct Sample {
+        double time;             // force sample time (s)
+        double force;
+        double balance;          // right minus left load cell (kg), 0 with one load cell
+        double displacement;
+        double displacementTime; // caliper frame time (s), same clock as time
+        int sequence;            // frame sequence number, -1 for CSV samples
+        bool burst;              // part of a full-rate burst around a tamp
+        bool rateChange;         // sample spacing changes from here on
+        double hostTime;         // host clock time (s), 0 until the clock is synchronized
+    };
+
+    // Reply to a clock sync ping, with device times on the same clock as
+    // Sample::time
+    struct Pong {
+        quint32 token;
+        double receiveTime;  // device time the ping arrived (s)
+        double transmitTime; // device time the reply left (s)
+    };
+
+    // Consecutive frame sequence numbers, wrapping at 65536
+    struct Range {
+        quint16 first;
+        quint16 count;
+    };
+
+    void setCountsPerKg(double counts);
+    double countsPerKg() const;
+
+    // Decode a notification payload or serial line, appending any samples
+    // found. Accepts delta-compressed and retransmitted packets, with or
+    // without balance, batches of binary sample frames, and
+    // "time,force,displacement[,balance]" CSV text. Returns false if the
+    // payload could not be decoded.
+    bool decode(const QByteArray &payload, QVector<Sample> &samples);
+
+    // Move out the frames known to be missing from the live stream: packets
+    // that never arrived, and records that could not be decoded after them
+    void takeMissing(QVector<Range> &ranges);
+
+    // Move out the ping replies decoded since the last call
+    void takePongs(QVector<Pong> &replies);
+
+    // CSV rows rejected since the last reset, and why the latest one was
+    quint32 rejectedRows() const;
+    CsvStatus lastRejection() const;
+
+    void reset();
+
+private:
+    // State of a delta-compressed stream, valid once a keyframe has been seen
+    struct DeltaState {
+        bool started;
+        bool synced;
+        quint16 sequence;
+        quint32 timestamp;
+        quint32 interval;
+        qint32 forceCounts;
+        quint32 caliperWord;
+        quint32 caliperTime;
+        qint32 balanceCounts;
+    };
+
+    double forceCountsPerKg;
+
+    qint64 lastTime;
+    bool timeValid;
+
+    DeltaState live;
+    DeltaState resent;
+    QVector<Range> missing;
+    QVector<Pong> pongs;
+
+    quint32 rejected;
+    CsvStatus rejection;
+
+    qint64 unwrapTime(quint32 timestamp);
+    bool decodePong(const QByteArray &payload);
+    bool decodeDelta(const QByteArray &payload, int valueCount, DeltaState &state,
+                     QVector<Sample> &samples);
+    bool decodeFrame(const char *frame, int version, QVector<Sample> &samples);
+    void addSample(int sequence, quint8 flags, quint32 timestamp, qint32 forceCounts,
+                   quint32 caliperWord, qint32 caliperOffset, qint32 balanceCounts,
+                   QVector<Sample> &samples);
+    void addMissing(quint16 first, quint16 count);
+    bool decodeCsv(const QByteArray &payload, QVector<Sample> &samples);
+};
+
+#endif // SAMPLEDECODER_H
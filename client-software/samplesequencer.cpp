@@ -0,0 +1,153 @@
+#include "samplesequencer.h"
+
+#include <QtEndian>
+
+#define CONTROL_RETRANSMIT 0x02
+
+// A missing frame is requested again after RETRY_MS, and given up on once
+// MAX_REQUESTS requests have gone unanswered
+#define RETRY_MS 300
+#define MAX_REQUESTS 3
+
+// Largest range asked for in one request, the size of the device history
+#define MAX_REQUEST_FRAMES 512
+
+SampleSequencer::SampleSequencer():
+    started(false),
+    next(0),
+    dropped(0),
+    recovered(0)
+{
+}
+
+void SampleSequencer::addMissing(const QVector<SampleDecoder::Range> &ranges, qint64 now)
+{
+    for (const SampleDecoder::Range &range : ranges) {
+        for (int i = 0; i < range.count; i++) {
+            qint64 sequence = unwrap(range.first + i);
+            if (sequence < next || pending.contains(sequence) || missing.contains(sequence)) continue;
+            missing.insert(sequence, {now, 0, 0});
+        }
+    }
+}
+
+void SampleSequencer::add(const QVector<SampleDecoder::Sample> &samples, qint64 now)
+{
+    Q_UNUSED(now);
+
+    for (const SampleDecoder::Sample &sample : samples) {
+        if (sample.sequence < 0) {
+            unsequenced.push_back(sample);
+            continue;
+        }
+
+        // Anything before next is a duplicate or arrived after it was given up
+        qint64 sequence = unwrap(sample.sequence);
+        if (sequence < next) continue;
+
+        if (missing.remove(sequence)) recovered++;
+        pending.insert(sequence, sample);
+    }
+}
+
+void SampleSequencer::release(QVector<SampleDecoder::Sample> &samples, qint64 now)
+{
+    samples += unsequenced;
+    unsequenced.clear();
+
+    for (;;) {
+        auto sample = pending.find(next);
+        if (sample != pending.end()) {
+            samples.push_back(sample.value());
+            pending.erase(sample);
+            next++;
+            continue;
+        }
+
+        // Wait for a missing frame until its requests have run out
+        auto gap = missing.find(next);
+        if (gap != missing.end()) {
+            if (gap->requests < MAX_REQUESTS || now - gap->requested < RETRY_MS) break;
+            missing.erase(gap);
+            dropped++;
+            next++;
+            continue;
+        }
+
+        // Other holes are frames the device dropped and never sent
+        if (pending.isEmpty() && missing.isEmpty()) break;
+        next = pending.isEmpty() ? missing.firstKey() :
+               missing.isEmpty() ? pending.firstKey() :
+               qMin(pending.firstKey(), missing.firstKey());
+    }
+}
+
+void SampleSequencer::takeRequests(QVector<SampleDecoder::Range> &ranges, qint64 now)
+{
+    qint64 first = 0;
+    int count = 0;
+
+    for (auto gap = missing.begin(); gap != missing.end(); ++gap) {
+        if (gap->requests >= MAX_REQUESTS || (gap->requests > 0 && now - gap->requested < RETRY_MS)) {
+            continue;
+        }
+        gap->requests++;
+        gap->requested = now;
+
+        // Merge consecutive frames into one range
+        if (count > 0 && gap.key() == first + count && count < MAX_REQUEST_FRAMES) {
+            count++;
+            continue;
+        }
+        if (count > 0) ranges.push_back({quint16(first), quint16(count)});
+        first = gap.key();
+        count = 1;
+    }
+
+    if (count > 0) ranges.push_back({quint16(first), quint16(count)});
+}
+
+QByteArray SampleSequencer::retransmitCommand(const SampleDecoder::Range &range)
+{
+    QByteArray command(5, 0);
+    command[0] = CONTROL_RETRANSMIT;
+    qToLittleEndian<quint16>(range.first, command.data() + 1);
+    qToLittleEndian<quint16>(range.count, command.data() + 3);
+    return command;
+}
+
+bool SampleSequencer::idle() const
+{
+    return pending.isEmpty() && missing.isEmpty();
+}
+
+quint32 SampleSequencer::droppedFrames() const
+{
+    return dropped;
+}
+
+quint32 SampleSequencer::recoveredFrames() const
+{
+    return recovered;
+}
+
+void SampleSequencer::reset()
+{
+    started = false;
+    next = 0;
+    unsequenced.clear();
+    pending.clear();
+    missing.clear();
+}
+
+qint64 SampleSequencer::unwrap(quint16 sequence)
+{
+    if (!started) {
+        started = true;
+        next = sequence;
+        return sequence;
+    }
+
+    // Nearest sequence number to the next one expected
+    return next + qint16(quint16(sequence - quint16(next)));
+}
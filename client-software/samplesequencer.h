@@ -0,0 +1,62 @@
+#ifndef SAMPLESEQUENCER_H
+#define SAMPLESEQUENCER_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QVector>
+
+#include "sampledecoder.h"
+
+// Puts decoded samples back in sequence order before they reach trigger
+// detection. Frames known to be missing hold back the samples after them
+// while they are requested from the device again; a frame that has not
+// arrived after a few requests is given up on and counted as dropped.
+class SampleSequencer
+{
+public:
+    SampleSequencer();
+
+    // Note frames missing from the stream, as found by the decoder
+    void addMissing(const QVector<SampleDecoder::Range> &ranges, qint64 now);
+
+    // Add live or retransmitted samples, in any order
+    void add(const QVector<SampleDecoder::Sample> &samples, qint64 now);
+
+    // Move out the samples that are now in order
+    void release(QVector<SampleDecoder::Sample> &samples, qint64 now);
+
+    // Ranges of missing frames that are due to be requested
+    void takeRequests(QVector<SampleDecoder::Range> &ranges, qint64 now);
+
+    // Control characteristic command asking the device to resend a range
+    static QByteArray retransmitCommand(const SampleDecoder::Range &range);
+
+    // Nothing held back or waiting to be requested
+    bool idle() const;
+
+    quint32 droppedFrames() const;
+    quint32 recoveredFrames() const;
+
+    void reset();
+
+private:
+    struct Missing {
+        qint64 since;
+        qint64 requested;
+        int requests;
+    };
+
+    bool started;
+    qint64 next; // sequence number of the next sample to release, unwrapped
+
+    QVector<SampleDecoder::Sample> unsequenced;
+    QMap<qint64, SampleDecoder::Sample> pending;
+    QMap<qint64, Missing> missing;
+
+    quint32 dropped;
+    quint32 recovered;
+
+    qint64 unwrap(quint16 sequence);
+};
+
+#endif // SAMPLESEQUENCER_H
@@ -0,0 +1,84 @@
+#include "serialsource.h"
+
+// Longest line kept, well over a sample row
+#define LINE_SIZE 256
+
+// Rejected lines are reported at most this often
+#define REPORT_INTERVAL_MS 1000
+
+SerialSource::SerialSource(const QString &portName, qint32 baudRate, QObject *parent):
+    DataSource(parent),
+    portName(portName),
+    baudRate(baudRate),
+    port(nullptr),
+    reportTimer(nullptr),
+    reportedRejected(0),
+    skipping(false)
+{
+}
+
+void SerialSource::start()
+{
+    port = new QSerialPort(portName, this);
+    port->setBaudRate(baudRate);
+    connect(port, &QSerialPort::readyRead, this, &SerialSource::onReadyRead);
+    connect(port, &QSerialPort::errorOccurred, this, &SerialSource::onErrorOccurred);
+
+    reportTimer = new QTimer(this);
+    connect(reportTimer, &QTimer::timeout, this, &SerialSource::onReportTimer);
+
+    if (!port->open(QIODevice::ReadOnly)) {
+        emit failed("Cannot open " + portName + ": " + port->errorString());
+        emit disconnected();
+        return;
+    }
+    emit statusMessage("Reading samples from " + portName);
+    reportTimer->start(REPORT_INTERVAL_MS);
+}
+
+void SerialSource::stop()
+{
+    if (port && port->isOpen()) port->close();
+    if (reportTimer) reportTimer->stop();
+}
+
+void SerialSource::onReadyRead()
+{
+    // Lines are read into a fixed buffer and decoded in place
+    char line[LINE_SIZE];
+    samples.clear();
+    while (port->canReadLine()) {
+        qint64 length = port->readLine(line, sizeof(line));
+        if (length <= 0) break;
+
+        bool complete = line[length - 1] == '\n';
+        if (complete && !skipping) decoder.decode(QByteArray::fromRawData(line, int(length)), samples);
+        skipping = !complete;
+    }
+
+    if (!samples.isEmpty()) emit samplesReceived(samples);
+}
+
+void SerialSource::onErrorOccurred(QSerialPort::SerialPortError error)
+{
+    if (error == QSerialPort::NoError) return;
+
+    if (error == QSerialPort::ResourceError) {
+        // The device was unplugged, and the port is not opened again
+        emit failed("Serial port lost: " + port->errorString());
+        stop();
+        emit disconnected();
+        return;
+    }
+    emit statusMessage("Serial error: " + port->errorString());
+}
+
+void SerialSource::onReportTimer()
+{
+    if (decoder.rejectedRows() == reportedRejected) return;
+
+    emit statusMessage(QString("Skipped %1 serial lines that were not samples, the last one %2")
+                       .arg(decoder.rejectedRows() - reportedRejected)
+                       .arg(csvStatusText(decoder.lastRejection())));
+    reportedRejected = decoder.rejectedRows();
+}
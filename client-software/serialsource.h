@@ -0,0 +1,44 @@
+#ifndef SERIALSOURCE_H
+#define SERIALSOURCE_H
+
+#include <QSerialPort>
+#include <QTimer>
+#include <QVector>
+
+#include "datasource.h"
+#include "sampledecoder.h"
+
+// "time,force,displacement,balance" rows from the tamper's USB serial port,
+// printed when the firmware is built with SERIAL_SAMPLES. Log lines in
+// between are counted as rejected rows. Samples have no sequence numbers or
+// host times.
+class SerialSource : public DataSource
+{
+    Q_OBJECT
+
+public:
+    SerialSource(const QString &portName, qint32 baudRate, QObject *parent = nullptr);
+
+    void start() override;
+    void stop() override;
+
+private slots:
+    void onReadyRead();
+    void onErrorOccurred(QSerialPort::SerialPortError error);
+    void onReportTimer();
+
+private:
+    QString portName;
+    qint32 baudRate;
+    QSerialPort *port;
+    QTimer *reportTimer;
+
+    SampleDecoder decoder;
+    QVector<SampleDecoder::Sample> samples;
+    quint32 reportedRejected;
+
+    // The rest of a line too long for the buffer is skipped
+    bool skipping;
+};
+
+#endif // SERIALSOURCE_H
@@ -0,0 +1,167 @@
+#include "station.h"
+
+#include <algorithm>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+
+#include "hostclock.h"
+
+Station::Station(const QString &name, const SourceOptions &options, bool plotted,
+                 QObject *parent):
+    QObject(parent),
+    stationName(name),
+    worker(nullptr),
+    configValid(false),
+    dropped(0),
+    recovered(0),
+    trialFolder("trials"),
+    nextTrial(1)
+{
+    QSettings settings("QuantitativeCafe", "Tamper");
+    nextTrial = settings.value(settingsKey("trialNumber"), nextTrial).toInt();
+
+    worker = new IngestWorker(plotted ? &ingestQueue : nullptr, options);
+    worker->moveToThread(&ingestThread);
+    connect(&ingestThread, &QThread::started, worker, &IngestWorker::start);
+    connect(&ingestThread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(worker, &IngestWorker::samplesReady, this, &Station::samplesReady);
+    connect(worker, &IngestWorker::trialCompleted, this, &Station::onTrialCompleted);
+    connect(worker, &IngestWorker::deviceConfigRead, this, &Station::onDeviceConfigRead);
+    connect(worker, &IngestWorker::linkStatsChanged, this, &Station::onLinkStatsChanged);
+    connect(worker, &IngestWorker::clockSynchronized, this, &Station::clockSynchronized);
+    connect(worker, &IngestWorker::statusMessage, this, &Station::onStatusMessage);
+    connect(worker, &IngestWorker::disconnected, this, &Station::onDisconnected);
+    connect(worker, &IngestWorker::failed, this, &Station::onFailed);
+}
+
+Station::~Station()
+{
+    if (ingestThread.isRunning()) {
+        QMetaObject::invokeMethod(worker, &IngestWorker::stop, Qt::BlockingQueuedConnection);
+        ingestThread.quit();
+        ingestThread.wait();
+    } else {
+        delete worker;
+    }
+}
+
+void Station::start()
+{
+    ingestThread.start();
+}
+
+void Station::setTriggerLevels(double low, double high)
+{
+    QMetaObject::invokeMethod(worker, [worker = worker, low, high] {
+        worker->setTriggerLevels(low, high);
+    });
+}
+
+void Station::cancelTrial()
+{
+    QMetaObject::invokeMethod(worker, &IngestWorker::cancelTrial);
+}
+
+void Station::writeDeviceConfig(const DeviceConfig &config)
+{
+    QMetaObject::invokeMethod(worker, [worker = worker, config] {
+        worker->writeDeviceConfig(config);
+    });
+}
+
+void Station::setLogFolder(const QString &logFolder)
+{
+    trialFolder = stationName.isEmpty() ? logFolder : logFolder + "/" + stationName;
+}
+
+void Station::setTrialNumber(int number)
+{
+    if (number == nextTrial) return;
+
+    nextTrial = number;
+    QSettings settings("QuantitativeCafe", "Tamper");
+    settings.setValue(settingsKey("trialNumber"), nextTrial);
+    emit trialNumberChanged(nextTrial);
+}
+
+QString Station::fileName() const
+{
+    return trialFolder + "/trial-" + QString::number(nextTrial) + ".csv";
+}
+
+bool Station::saveTrial(const TrialData &trial)
+{
+    // Never stop recording over a file left by an earlier run
+    QDir().mkpath(trialFolder);
+    int number = nextTrial;
+    while (QFile::exists(trialFolder + "/trial-" + QString::number(number) + ".csv")) number++;
+    setTrialNumber(number);
+
+    QString error;
+    if (!trial.writeCsv(fileName(), wallClockOffset(), error)) {
+        onStatusMessage("Cannot write " + fileName() + ": " + error);
+        return false;
+    }
+
+    double peak = 0;
+    for (double force : trial.force) peak = std::max(peak, force);
+    onStatusMessage(QString("Saved %1, %2 samples, %3 s, peak %4 kg")
+                    .arg(fileName()).arg(trial.length())
+                    .arg(trial.time.last() - trial.time.first(), 0, 'f', 3)
+                    .arg(peak, 0, 'f', 3));
+
+    // Increment trial number
+    setTrialNumber(nextTrial + 1);
+    return true;
+}
+
+void Station::onTrialCompleted(const TrialData &trial)
+{
+    saveTrial(trial);
+    emit trialCompleted(trial);
+}
+
+void Station::onDeviceConfigRead(const DeviceConfig &config)
+{
+    this->config = config;
+    configValid = true;
+    emit deviceConfigRead(config);
+}
+
+void Station::onLinkStatsChanged(quint32 dropped, quint32 recovered)
+{
+    this->dropped = dropped;
+    this->recovered = recovered;
+    emit linkStatsChanged(dropped, recovered);
+}
+
+void Station::onStatusMessage(const QString &message)
+{
+    emit statusMessage(stationName.isEmpty() ? message : stationName + ": " + message);
+}
+
+void Station::onDisconnected()
+{
+    configValid = false;
+    emit disconnected();
+}
+
+void Station::onFailed(const QString &message)
+{
+    emit failed(stationName.isEmpty() ? message : stationName + ": " + message);
+}
+
+QString Station::settingsKey(const QString &key) const
+{
+    return stationName.isEmpty() ? key : "stations/" + stationName + "/" + key;
+}
+
+double Station::wallClockOffset() const
+{
+    // Taken afresh for each trial, so it follows the wall clock if that is
+    // stepped or drifts during a long session
+    return QDateTime::currentMSecsSinceEpoch() / 1000. - hostTime();
+}
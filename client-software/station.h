@@ -0,0 +1,92 @@
+#ifndef STATION_H
+#define STATION_H
+
+#include <QObject>
+#include <QThread>
+
+#include "datasource.h"
+#include "deviceconfig.h"
+#include "ingestworker.h"
+#include "trialdata.h"
+
+// One tamping station: a data source read on an ingest thread of its own,
+// with its own trigger state, trial numbering and trial folder. The only
+// station has no name and keeps the folder and settings the client has
+// always used; named stations each record to a subfolder of their own.
+class Station : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Samples are queued for plotting only if plotted is set
+    Station(const QString &name, const SourceOptions &options, bool plotted,
+            QObject *parent = nullptr);
+    ~Station();
+
+    QString name() const { return stationName; }
+
+    // Start the source on the ingest thread
+    void start();
+
+    void setTriggerLevels(double low, double high);
+    void cancelTrial();
+    void writeDeviceConfig(const DeviceConfig &config);
+
+    // Samples from the ingest thread, for the plots
+    IngestQueue *queue() { return &ingestQueue; }
+
+    bool deviceConfigValid() const { return configValid; }
+    const DeviceConfig &deviceConfig() const { return config; }
+
+    quint32 droppedFrames() const { return dropped; }
+    quint32 recoveredFrames() const { return recovered; }
+
+    // Where trials go, and the next one's number and file
+    void setLogFolder(const QString &logFolder);
+    QString folder() const { return trialFolder; }
+    int trialNumber() const { return nextTrial; }
+    void setTrialNumber(int number);
+    QString fileName() const;
+
+    // Write a trial to the next file, skipping any that already exist
+    bool saveTrial(const TrialData &trial);
+
+signals:
+    void samplesReady();
+    void trialCompleted(const TrialData &trial);
+    void trialNumberChanged(int number);
+    void deviceConfigRead(const DeviceConfig &config);
+    void linkStatsChanged(quint32 dropped, quint32 recovered);
+    void clockSynchronized(double drift, double offset, double roundTrip, int exchanges);
+    void statusMessage(const QString &message);
+    void disconnected();
+    void failed(const QString &message);
+
+private slots:
+    void onTrialCompleted(const TrialData &trial);
+    void onDeviceConfigRead(const DeviceConfig &config);
+    void onLinkStatsChanged(quint32 dropped, quint32 recovered);
+    void onStatusMessage(const QString &message);
+    void onDisconnected();
+    void onFailed(const QString &message);
+
+private:
+    QString stationName;
+
+    QThread ingestThread;
+    IngestWorker *worker;
+    IngestQueue ingestQueue;
+
+    DeviceConfig config;
+    bool configValid;
+    quint32 dropped;
+    quint32 recovered;
+
+    QString trialFolder;
+    int nextTrial;
+
+    QString settingsKey(const QString &key) const;
+    double wallClockOffset() const;
+};
+
+#endif // STATION_H
@@ -0,0 +1,252 @@
+#include "stationpanel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QGroupBox>
+#include <QVBoxLayout>
+
+#include "hostclock.h"
+#include "qcustomplot.h"
+#include "station.h"
+
+// Smallest balance axis range either side of zero (kg)
+#define BALANCE_MIN_RANGE 0.1
+
+StationPanel::StationPanel(Station *station, double triggerForceLow, QWidget *parent):
+    QWidget(parent),
+    source(station),
+    triggerForceLow(triggerForceLow),
+    triggered(false),
+    sampled(false),
+    unplotted(0),
+    liveChanged(false),
+    savedChanged(false)
+{
+    // Initialize plot limits
+    resetLiveLimits();
+    savedMaxForce = triggerForceLow;
+    savedMinDisplacement = 0;
+    savedMaxDisplacement = 0;
+    savedMaxBalance = BALANCE_MIN_RANGE;
+
+    // Live data above saved data, each in a box named for the station
+    QString name = station->name().isEmpty() ? QString() : station->name() + " ";
+    liveBox = new QGroupBox(name + "Live data", this);
+    savedBox = new QGroupBox(name + "Saved data", this);
+    livePlot = new QCustomPlot(liveBox);
+    savedPlot = new QCustomPlot(savedBox);
+    for (QCustomPlot *plot : {livePlot, savedPlot}) {
+        plot->setMinimumSize(200, 150);
+        plot->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+        connect(plot, &QCustomPlot::mousePress, this, &StationPanel::clicked);
+    }
+    (new QVBoxLayout(liveBox))->addWidget(livePlot);
+    (new QVBoxLayout(savedBox))->addWidget(savedPlot);
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(liveBox);
+    layout->addWidget(savedBox);
+
+    // Configure plots
+    liveCurve = configurePlot(livePlot);
+    savedCurve = configurePlot(savedPlot);
+    liveBalanceCurve = configureBalancePlot(livePlot);
+    savedBalanceCurve = configureBalancePlot(savedPlot);
+
+    connect(station, &Station::samplesReady, this, &StationPanel::onSamplesReady);
+    connect(station, &Station::trialCompleted, this, &StationPanel::onTrialCompleted);
+    connect(station, &Station::deviceConfigRead, this, &StationPanel::onDeviceConfigRead);
+    connect(station, &Station::disconnected, this, &StationPanel::onDisconnected);
+}
+
+void StationPanel::setTriggerForceLow(double force)
+{
+    triggerForceLow = force;
+    liveChanged = true;
+    savedChanged = true;
+}
+
+void StationPanel::setSelected(bool selected)
+{
+    setStyleSheet(selected ? "QGroupBox { font-weight: bold; }" : QString());
+}
+
+void StationPanel::cancelTrial()
+{
+    // The trigger clears when the worker's cancel comes through the queue,
+    // after the samples it had already queued
+    source->cancelTrial();
+}
+
+void StationPanel::onSamplesReady()
+{
+    // Clear the flag first, so samples queued while draining signal again
+    IngestQueue *queue = source->queue();
+    queue->signalled.exchange(false);
+
+    IngestSample item;
+    int taken = 0;
+    bool wasTriggered = triggered;
+    while (queue->samples.pop(item)) {
+        if (item.cancelled) {
+            triggered = false;
+            liveChanged = true;
+            continue;
+        }
+
+        const SampleDecoder::Sample &sample = item.sample;
+        current = sample;
+        taken++;
+
+        // Add to samples
+        liveData.append(sample);
+        triggered = item.triggered;
+
+        // Start afresh after a trial, as saving it used to
+        if (item.trialEnded) {
+            liveData = liveData.mid(liveData.length() - 1);
+            resetLiveLimits();
+        }
+
+        // Update plot limits
+        maxForce = std::max(maxForce, sample.force);
+        maxBalance = std::max(maxBalance, std::abs(sample.balance));
+        minDisplacement = std::min(minDisplacement, sample.displacement);
+        maxDisplacement = std::max(maxDisplacement, sample.displacement);
+    }
+    if (triggered != wasTriggered) emit triggerChanged();
+    if (taken == 0) return;
+
+    sampled = true;
+    unplotted += taken;
+    liveChanged = true;
+}
+
+void StationPanel::onTrialCompleted(const TrialData &trial)
+{
+    savedData = trial;
+    updateSavedLimits();
+    savedChanged = true;
+    emit trialCompleted();
+}
+
+void StationPanel::onDeviceConfigRead(const DeviceConfig &config)
+{
+    showBalance(config.loadCells > 1);
+}
+
+void StationPanel::onDisconnected()
+{
+    reportLatency();
+}
+
+bool StationPanel::replot()
+{
+    if (!liveChanged && !savedChanged) return false;
+
+    if (liveChanged) {
+        liveCurve->setData(liveData.time, liveData.force, liveData.displacement);
+        liveBalanceCurve->setData(liveData.time, liveData.force, liveData.balance);
+        livePlot->xAxis->setRange(triggerForceLow, maxForce);
+        livePlot->yAxis->setRange(minDisplacement, maxDisplacement);
+        livePlot->yAxis2->setRange(-maxBalance, maxBalance);
+        livePlot->replot();
+        liveChanged = false;
+    }
+
+    // The saved plot only changes with a new trial
+    if (savedChanged) {
+        savedCurve->setData(savedData.time, savedData.force, savedData.displacement);
+        savedBalanceCurve->setData(savedData.time, savedData.force, savedData.balance);
+        savedPlot->xAxis->setRange(triggerForceLow, savedMaxForce);
+        savedPlot->yAxis->setRange(savedMinDisplacement, savedMaxDisplacement);
+        savedPlot->yAxis2->setRange(-savedMaxBalance, savedMaxBalance);
+        savedPlot->replot();
+        savedChanged = false;
+    }
+
+    double plotted = hostTime();
+    int n = liveData.length();
+    for (int i = std::max(0, n - unplotted); i < n; i++) {
+        if (liveData.hostTime[i] > 0) plotLatency.add(plotted - liveData.hostTime[i]);
+    }
+    unplotted = 0;
+    return true;
+}
+
+QCPCurve *StationPanel::configurePlot(QCustomPlot *plot)
+{
+    plot->setBackground(QBrush(QColor(0, 0, 0, 0)));
+    plot->axisRect()->setBackground(QBrush(QColor(255, 255, 255, 255)));
+
+    QCPCurve *curve = new QCPCurve(plot->xAxis, plot->yAxis);
+    curve->setPen(QPen(QColor(40, 110, 255)));
+
+    plot->xAxis->setScaleType(QCPAxis::stLogarithmic);
+    QSharedPointer<QCPAxisTickerLog> logTicker(new QCPAxisTickerLog);
+    plot->xAxis->setTicker(logTicker);
+
+    plot->xAxis->setLabel("Force (kg)");
+    plot->yAxis->setLabel("Displacement (mm)");
+
+    plot->xAxis->setRange(triggerForceLow, maxForce);
+    plot->yAxis->setRange(minDisplacement, maxDisplacement);
+    plot->yAxis->setRangeReversed(true);
+
+    return curve;
+}
+
+QCPCurve *StationPanel::configureBalancePlot(QCustomPlot *plot)
+{
+    QCPCurve *curve = new QCPCurve(plot->xAxis, plot->yAxis2);
+    curve->setPen(QPen(QColor(230, 80, 40)));
+    curve->setVisible(false);
+
+    plot->yAxis2->setLabel("Balance R-L (kg)");
+    plot->yAxis2->setRange(-BALANCE_MIN_RANGE, BALANCE_MIN_RANGE);
+
+    return curve;
+}
+
+void StationPanel::showBalance(bool show)
+{
+    liveBalanceCurve->setVisible(show);
+    savedBalanceCurve->setVisible(show);
+    livePlot->yAxis2->setVisible(show);
+    savedPlot->yAxis2->setVisible(show);
+    liveChanged = true;
+    savedChanged = true;
+}
+
+void StationPanel::resetLiveLimits()
+{
+    maxForce = triggerForceLow;
+    minDisplacement = 1000;
+    maxDisplacement = -1000;
+    maxBalance = BALANCE_MIN_RANGE;
+}
+
+void StationPanel::updateSavedLimits()
+{
+    savedMaxForce = triggerForceLow;
+    savedMinDisplacement = 1000;
+    savedMaxDisplacement = -1000;
+    savedMaxBalance = BALANCE_MIN_RANGE;
+
+    for (int i = 0; i < savedData.length(); ++i) {
+        savedMaxForce = std::max(savedMaxForce, savedData.force[i]);
+        savedMaxBalance = std::max(savedMaxBalance, std::abs(savedData.balance[i]));
+        savedMinDisplacement = std::min(savedMinDisplacement, savedData.displacement[i]);
+        savedMaxDisplacement = std::max(savedMaxDisplacement, savedData.displacement[i]);
+    }
+}
+
+void StationPanel::reportLatency()
+{
+    if (plotLatency.count() > 0) {
+        QString name = source->name().isEmpty() ? QString() : source->name() + ": ";
+        emit statusMessage(name + "Capture to plot latency:\n" + plotLatency.report(10).trimmed());
+    }
+    plotLatency.reset();
+}
@@ -0,0 +1,110 @@
+#ifndef STATIONPANEL_H
+#define STATIONPANEL_H
+
+#include <QWidget>
+
+#include "deviceconfig.h"
+#include "latencyhistogram.h"
+#include "sampledecoder.h"
+#include "trialdata.h"
+
+class QCustomPlot;
+class QCPCurve;
+class QGroupBox;
+class Station;
+
+// Live and saved plots for one station. Samples are taken from the
+// station's queue as they arrive, but only drawn when replot is called, so
+// the GUI redraws at a fixed rate however many stations there are.
+class StationPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    StationPanel(Station *station, double triggerForceLow, QWidget *parent = nullptr);
+
+    Station *station() const { return source; }
+
+    void setTriggerForceLow(double force);
+    void setSelected(bool selected);
+
+    // Draw the plots if anything changed since they were last drawn.
+    // Returns whether they were.
+    bool replot();
+
+    // A trial is in progress
+    bool isTriggered() const { return triggered; }
+    void cancelTrial();
+
+    // The last sample taken, if there has been one
+    bool hasSample() const { return sampled; }
+    const SampleDecoder::Sample &currentSample() const { return current; }
+
+    const TrialData &savedTrial() const { return savedData; }
+
+    // Per-sample latency from capture on the device to the plot showing it
+    const LatencyHistogram &latency() const { return plotLatency; }
+
+signals:
+    void clicked();
+    void triggerChanged();
+    void trialCompleted();
+    void statusMessage(const QString &message);
+
+private slots:
+    void onSamplesReady();
+    void onTrialCompleted(const TrialData &trial);
+    void onDeviceConfigRead(const DeviceConfig &config);
+    void onDisconnected();
+
+private:
+    Station *source;
+
+    QGroupBox *liveBox;
+    QGroupBox *savedBox;
+    QCustomPlot *livePlot;
+    QCustomPlot *savedPlot;
+
+    double triggerForceLow;
+
+    double maxForce;
+    double minDisplacement;
+    double maxDisplacement;
+    double maxBalance;
+
+    double savedMaxForce;
+    double savedMinDisplacement;
+    double savedMaxDisplacement;
+    double savedMaxBalance;
+
+    LatencyHistogram plotLatency;
+
+    TrialData liveData;
+    TrialData savedData;
+
+    QCPCurve *liveCurve;
+    QCPCurve *savedCurve;
+
+    // Right minus left load cell against force, shown with two load cells
+    QCPCurve *liveBalanceCurve;
+    QCPCurve *savedBalanceCurve;
+
+    bool triggered;
+    bool sampled;
+    SampleDecoder::Sample current;
+
+    // Samples taken since the plots were last drawn, and which plots need
+    // drawing again
+    int unplotted;
+    bool liveChanged;
+    bool savedChanged;
+
+    QCPCurve *configurePlot(QCustomPlot *plot);
+    QCPCurve *configureBalancePlot(QCustomPlot *plot);
+    void showBalance(bool show);
+    void resetLiveLimits();
+    void updateSavedLimits();
+    void reportLatency();
+};
+
+#endif // STATIONPANEL_H
@@ -0,0 +1,82 @@
+#include "syntheticsource.h"
+
+#include <cmath>
+
+#include "hostclock.h"
+
+#define SYNTHETIC_TICK_MS 10
+
+// Load cell noise (kg) and caliper resolution (mm)
+#define FORCE_NOISE 0.005
+#define CALIPER_STEP 0.01
+
+SyntheticSource::SyntheticSource(double rate, double tampPeriod, double peakForce, quint32 seed,
+                                 QObject *parent):
+    DataSource(parent),
+    rate(rate),
+    tampPeriod(tampPeriod),
+    peakForce(peakForce),
+    timer(nullptr),
+    random(seed),
+    startHost(0),
+    generated(0)
+{
+}
+
+void SyntheticSource::start()
+{
+    emit statusMessage(QString("Generating %1 samples/s, a %2 kg tamp every %3 s")
+                       .arg(rate).arg(peakForce).arg(tampPeriod));
+
+    timer = new QTimer(this);
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, &QTimer::timeout, this, &SyntheticSource::onTick);
+    startHost = hostTime();
+    generated = 0;
+    timer->start(SYNTHETIC_TICK_MS);
+}
+
+void SyntheticSource::stop()
+{
+    if (timer) timer->stop();
+}
+
+double SyntheticSource::forceAt(double time) const
+{
+    // Ramp up, hold and release at the end of each period, as in sim_signals.cpp
+    const double ramp = 0.3, hold = 0.2, release = 0.2;
+    double phase = std::fmod(time, tampPeriod) - (tampPeriod - ramp - hold - release);
+
+    if (phase < 0) return 0;
+    if (phase < ramp) return peakForce * phase / ramp;
+    phase -= ramp;
+    if (phase < hold) return peakForce;
+    phase -= hold;
+    if (phase < release) return peakForce * (1 - phase / release);
+    return 0;
+}
+
+void SyntheticSource::onTick()
+{
+    // Every sample due by now
+    qint64 due = qint64((hostTime() - startHost) * rate);
+
+    batch.clear();
+    for (; generated < due; generated++) {
+        double time = generated / rate;
+        double force = forceAt(time);
+
+        SampleDecoder::Sample sample;
+        sample.time = time;
+        sample.force = force + FORCE_NOISE * (random.generateDouble() * 2 - 1);
+        sample.balance = 0;
+        sample.displacement = std::round((20 - 8 * force / peakForce) / CALIPER_STEP) * CALIPER_STEP;
+        sample.displacementTime = time;
+        sample.sequence = -1;
+        sample.burst = false;
+        sample.rateChange = false;
+        sample.hostTime = startHost + time;
+        batch.push_back(sample);
+    }
+    if (!batch.isEmpty()) emit samplesReceived(batch);
+}
@@ -0,0 +1,42 @@
+#ifndef SYNTHETICSOURCE_H
+#define SYNTHETICSOURCE_H
+
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QVector>
+
+#include "datasource.h"
+#include "sampledecoder.h"
+
+// Generated tamps, the same shape as the firmware simulator's, at any
+// sample rate, for load testing the client without a device. Samples are
+// timed on the host clock, so host time is the time they were generated.
+class SyntheticSource : public DataSource
+{
+    Q_OBJECT
+
+public:
+    SyntheticSource(double rate, double tampPeriod, double peakForce, quint32 seed,
+                    QObject *parent = nullptr);
+
+    void start() override;
+    void stop() override;
+
+private slots:
+    void onTick();
+
+private:
+    double rate;
+    double tampPeriod;
+    double peakForce;
+    QTimer *timer;
+    QRandomGenerator random;
+
+    QVector<SampleDecoder::Sample> batch;
+    double startHost; // host time of the first sample (s)
+    qint64 generated; // samples so far
+
+    double forceAt(double time) const;
+};
+
+#endif // SYNTHETICSOURCE_H
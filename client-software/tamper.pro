@@ -1,6 +1,6 @@
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets printsupport network bluetooth
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets printsupport network bluetooth serialport
 
 CONFIG += c++17
 
@@ -9,15 +9,51 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    blesource.cpp \
+    clocksync.cpp \
+    datasource.cpp \
+    deviceconfig.cpp \
+    devicescanner.cpp \
+    headlessrecorder.cpp \
+    hostclock.cpp \
+    ingestworker.cpp \
+    latencyhistogram.cpp \
     main.cpp \
     mainwindow.cpp \
     optionsdialog.cpp \
-    qcustomplot.cpp
+    qcustomplot.cpp \
+    replaysource.cpp \
+    sampledecoder.cpp \
+    samplesequencer.cpp \
+    serialsource.cpp \
+    station.cpp \
+    stationpanel.cpp \
+    syntheticsource.cpp \
+    trialdata.cpp
 
 HEADERS += \
+    blesource.h \
+    clocksync.h \
+    csvparser.h \
+    datasource.h \
+    deviceconfig.h \
+    devicescanner.h \
+    headlessrecorder.h \
+    hostclock.h \
+    ingestworker.h \
+    latencyhistogram.h \
     mainwindow.h \
     optionsdialog.h \
-    qcustomplot.h
+    qcustomplot.h \
+    replaysource.h \
+    sampledecoder.h \
+    samplesequencer.h \
+    serialsource.h \
+    spscqueue.h \
+    station.h \
+    stationpanel.h \
+    syntheticsource.h \
+    trialdata.h
 
 FORMS += \
     mainwindow.ui \
@@ -0,0 +1,15 @@
+QT       += testlib
+QT       -= gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../sampledecoder.cpp \
+    tst_parserbench.cpp
+
+HEADERS += \
+    ../../csvparser.h \
+    ../../sampledecoder.h
@@ -0,0 +1,303 @@
+// Benchmark of the legacy CSV sample path: the in-place parser against the
+// QString split it replaced, per row of a second of rows at a synthetic
+// 10 kHz. Also a minute of the device's own stream, delta packets of a full
+// batch at its highest rate, and the decoding of each binary frame layout.
+// Run with -tickcounter or -iterations N for steadier figures.
+
+#include <QByteArray>
+#include <QStringList>
+#include <QVector>
+#include <QtEndian>
+#include <QtTest>
+
+#include "csvparser.h"
+#include "sampledecoder.h"
+
+#define SYNTHETIC_RATE_HZ 10000
+#define ROWS 10000
+
+// The device's defaults: 80 SPS from the HX711, 32 samples a notification,
+// each packet opening with a keyframe (KEYFRAME_INTERVAL in protocol.h)
+#define DEVICE_RATE_HZ 80
+#define DEVICE_BATCH_SAMPLES 32
+#define DEVICE_SECONDS 60
+
+#define PACKET_VERSION_DELTA 6
+#define RECORD_KEYFRAME 0x80
+
+#define FRAME_FLAG_CALIPER_VALID 0x01
+#define FRAME_FLAG_STREAMING     0x08
+#define FRAME_FLAG_RATE_CHANGE   0x20
+
+static volatile double sink;
+
+class ParserBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void qstringSplit();
+    void inPlace();
+    void decode();
+    void deviceStream();
+    void malformedRows_data();
+    void malformedRows();
+    void binaryFrames_data();
+    void binaryFrames();
+    void mixedVersions();
+
+private:
+    QVector<QByteArray> rows;
+    QVector<QByteArray> packets;
+
+    static QByteArray frame(int version, quint8 flags, quint16 sequence, quint32 timestamp,
+                            qint32 forceCounts, quint32 caliperWord, qint32 caliperOffset,
+                            qint32 balanceCounts);
+};
+
+// A SampleFrame as protocol.h lays it out, cut to the size of its version
+QByteArray ParserBench::frame(int version, quint8 flags, quint16 sequence, quint32 timestamp,
+                              qint32 forceCounts, quint32 caliperWord, qint32 caliperOffset,
+                              qint32 balanceCounts)
+{
+    QByteArray bytes(version == 1 ? 16 : version == 2 ? 20 : 24, 0);
+    char *data = bytes.data();
+    data[0] = char(version);
+    data[1] = char(flags);
+    qToLittleEndian<quint16>(sequence, data + 2);
+    qToLittleEndian<quint32>(timestamp, data + 4);
+    qToLittleEndian<qint32>(forceCounts, data + 8);
+    qToLittleEndian<quint32>(caliperWord, data + 12);
+    if (version >= 2) qToLittleEndian<qint32>(caliperOffset, data + 16);
+    if (version >= 8) qToLittleEndian<qint32>(balanceCounts, data + 20);
+    return bytes;
+}
+
+static void putVarint(QByteArray &out, quint32 value)
+{
+    while (value >= 0x80) {
+        out.append(char(value | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+static quint32 zigzag(qint32 value)
+{
+    return (quint32(value) << 1) ^ quint32(value >> 31);
+}
+
+void ParserBench::initTestCase()
+{
+    // Rows as the legacy firmware printed them
+    for (int i = 0; i < ROWS; i++) {
+        double time = double(i) / SYNTHETIC_RATE_HZ;
+        double phase = (i % 2000) / 1000.;
+        double force = 15 * (phase < 1 ? phase : 2 - phase);
+        rows.push_back(QByteArray::number(time, 'f', 4) + "," + QByteArray::number(force, 'f', 3) + "," +
+                       QByteArray::number(-12.34 + i * 1e-4, 'f', 2));
+    }
+
+    // Delta packets as DeltaEncoder writes them, with a tamp every 10 s
+    QByteArray packet;
+    quint32 lastTimestamp = 0, lastInterval = 0, lastCaliperTime = 0;
+    qint32 lastForce = 0, lastBalance = 0;
+    quint32 lastCaliper = 0;
+    for (int i = 0; i < DEVICE_SECONDS * DEVICE_RATE_HZ; i++) {
+        double phase = (i % (10 * DEVICE_RATE_HZ)) / double(DEVICE_RATE_HZ);
+        double force = phase < 1 ? 15 * phase : phase < 2 ? 15 * (2 - phase) : 0.02;
+        quint32 timestamp = quint32(i) * (1000000 / DEVICE_RATE_HZ);
+        qint32 forceCounts = qint32(force * FORCE_COUNTS_PER_KG);
+        quint32 caliperWord = quint32(1234 - (phase < 2 ? 50 * phase : 100));
+        quint32 caliperTime = timestamp - 3000;
+        qint32 balanceCounts = forceCounts / 20;
+
+        if (i % DEVICE_BATCH_SAMPLES == 0) {
+            if (!packet.isEmpty()) packets.push_back(packet);
+            packet = QByteArray(3, 0);
+            packet[0] = char(PACKET_VERSION_DELTA);
+            qToLittleEndian<quint16>(quint16(i), packet.data() + 1);
+
+            packet.append(char(FRAME_FLAG_CALIPER_VALID | FRAME_FLAG_STREAMING | RECORD_KEYFRAME));
+            putVarint(packet, timestamp);
+            putVarint(packet, zigzag(forceCounts));
+            putVarint(packet, caliperWord);
+            putVarint(packet, zigzag(qint32(caliperTime - timestamp)));
+            putVarint(packet, zigzag(balanceCounts));
+            lastInterval = 0;
+        } else {
+            packet.append(char(FRAME_FLAG_CALIPER_VALID | FRAME_FLAG_STREAMING));
+            putVarint(packet, zigzag(qint32(timestamp - lastTimestamp - lastInterval)));
+            putVarint(packet, zigzag(qint32(quint32(forceCounts) - quint32(lastForce))));
+            putVarint(packet, zigzag(qint32(caliperWord - lastCaliper)));
+            putVarint(packet, zigzag(qint32(caliperTime - lastCaliperTime)));
+            putVarint(packet, zigzag(qint32(quint32(balanceCounts) - quint32(lastBalance))));
+            lastInterval = timestamp - lastTimestamp;
+        }
+        lastTimestamp = timestamp;
+        lastForce = forceCounts;
+        lastCaliper = caliperWord;
+        lastCaliperTime = caliperTime;
+        lastBalance = balanceCounts;
+    }
+    packets.push_back(packet);
+}
+
+void ParserBench::qstringSplit()
+{
+    // The path this replaced: a QString, a QStringList and a string per column
+    QBENCHMARK {
+        for (const QByteArray &row : rows) {
+            QStringList cols = QString::fromUtf8(row).split(",");
+            if (cols.count() != 3) continue;
+            sink = cols[0].toDouble() + cols[1].toDouble() + cols[2].toDouble();
+        }
+    }
+}
+
+void ParserBench::inPlace()
+{
+    QBENCHMARK {
+        for (const QByteArray &row : rows) {
+            double values[3];
+            if (parseCsvRow(row.constData(), row.size(), values, 3) != CsvOk) continue;
+            sink = values[0] + values[1] + values[2];
+        }
+    }
+}
+
+void ParserBench::decode()
+{
+    // Through the decoder, into a vector that is already big enough
+    SampleDecoder decoder;
+    QVector<SampleDecoder::Sample> samples;
+    samples.reserve(1);
+    QBENCHMARK {
+        for (const QByteArray &row : rows) {
+            samples.clear();
+            decoder.decode(row, samples);
+        }
+    }
+    QVERIFY(samples.size() == 1);
+}
+
+void ParserBench::deviceStream()
+{
+    // A minute of notifications, each decoded into a vector already big enough
+    SampleDecoder decoder;
+    QVector<SampleDecoder::Sample> samples;
+    samples.reserve(DEVICE_BATCH_SAMPLES);
+    QVector<SampleDecoder::Range> missing;
+    QBENCHMARK {
+        decoder.reset();
+        for (const QByteArray &packet : packets) {
+            samples.clear();
+            decoder.decode(packet, samples);
+        }
+    }
+    QCOMPARE(samples.size(), DEVICE_BATCH_SAMPLES);
+    QCOMPARE(samples.last().sequence, DEVICE_SECONDS * DEVICE_RATE_HZ - 1);
+    QCOMPARE(samples.last().time, (DEVICE_SECONDS * DEVICE_RATE_HZ - 1) / double(DEVICE_RATE_HZ));
+    decoder.takeMissing(missing);
+    QVERIFY(missing.isEmpty());
+}
+
+void ParserBench::malformedRows_data()
+{
+    QTest::addColumn<QByteArray>("row");
+    QTest::addColumn<int>("status");
+
+    QTest::newRow("too few columns") << QByteArray("1.0,2.0") << int(CsvColumnCount);
+    QTest::newRow("too many columns") << QByteArray("1.0,2.0,3.0,4.0") << int(CsvColumnCount);
+    QTest::newRow("empty column") << QByteArray("1.0,,3.0") << int(CsvBadNumber);
+    QTest::newRow("not a number") << QByteArray("1.0,2x,3.0") << int(CsvBadNumber);
+}
+
+void ParserBench::malformedRows()
+{
+    QFETCH(QByteArray, row);
+    QFETCH(int, status);
+
+    double values[3];
+    QCOMPARE(int(parseCsvRow(row.constData(), row.size(), values, 3)), status);
+}
+
+void ParserBench::binaryFrames_data()
+{
+    QTest::addColumn<QByteArray>("payload");
+    QTest::addColumn<int>("sequence");
+    QTest::addColumn<double>("time");
+    QTest::addColumn<double>("force");
+    QTest::addColumn<double>("balance");
+    QTest::addColumn<double>("displacement");
+    QTest::addColumn<double>("displacementTime");
+    QTest::addColumn<bool>("burst");
+    QTest::addColumn<bool>("rateChange");
+
+    // Older layouts have no caliper time offset (v1) or balance (v1 and v2)
+    QTest::newRow("v1, 16 bytes")
+        << frame(1, FRAME_FLAG_CALIPER_VALID | FRAME_FLAG_STREAMING, 7, 1500000, 104945, 1234, -2500, 5000)
+        << 7 << 1.5 << 104945 / FORCE_COUNTS_PER_KG << 0. << 12.34 << 1.5 << true << false;
+    QTest::newRow("v2, 20 bytes")
+        << frame(2, FRAME_FLAG_CALIPER_VALID | FRAME_FLAG_RATE_CHANGE, 8, 1512500, -2000, (1u << 20) | 550,
+                 -2500, 5000)
+        << 8 << 1.5125 << -2000 / FORCE_COUNTS_PER_KG << 0. << -5.5 << 1.51 << false << true;
+    QTest::newRow("v8, 24 bytes")
+        << frame(8, FRAME_FLAG_CALIPER_VALID | FRAME_FLAG_STREAMING, 65535, 4000000000u, 1574176, 1234,
+                 -2500, -20989)
+        << 65535 << 4000. << 1574176 / FORCE_COUNTS_PER_KG << -20989 / FORCE_COUNTS_PER_KG << 12.34
+        << 3999.9975 << true << false;
+    QTest::newRow("v8, caliper invalid")
+        << frame(8, 0, 9, 1525000, 52472, 1234, -2500, 20989)
+        << 9 << 1.525 << 52472 / FORCE_COUNTS_PER_KG << 20989 / FORCE_COUNTS_PER_KG << 0. << 1.5225
+        << false << false;
+}
+
+void ParserBench::binaryFrames()
+{
+    QFETCH(QByteArray, payload);
+    QFETCH(int, sequence);
+    QFETCH(double, time);
+    QFETCH(double, force);
+    QFETCH(double, balance);
+    QFETCH(double, displacement);
+    QFETCH(double, displacementTime);
+    QFETCH(bool, burst);
+    QFETCH(bool, rateChange);
+
+    SampleDecoder decoder;
+    QVector<SampleDecoder::Sample> samples;
+    QVERIFY(decoder.decode(payload, samples));
+    QCOMPARE(samples.size(), 1);
+
+    const SampleDecoder::Sample &sample = samples[0];
+    QCOMPARE(sample.sequence, sequence);
+    QCOMPARE(sample.time, time);
+    QCOMPARE(sample.force, force);
+    QCOMPARE(sample.balance, balance);
+    QCOMPARE(sample.displacement, displacement);
+    QCOMPARE(sample.displacementTime, displacementTime);
+    QCOMPARE(sample.burst, burst);
+    QCOMPARE(sample.rateChange, rateChange);
+    QCOMPARE(sample.hostTime, 0.);
+}
+
+void ParserBench::mixedVersions()
+{
+    // Frames of one notification must all be the same layout
+    SampleDecoder decoder;
+    QVector<SampleDecoder::Sample> samples;
+    QByteArray batch = frame(8, 0, 1, 1000, 0, 0, 0, 0) + frame(8, 0, 2, 13500, 0, 0, 0, 0);
+    QVERIFY(decoder.decode(batch, samples));
+    QCOMPARE(samples.size(), 2);
+
+    samples.clear();
+    batch[24] = char(2);
+    QVERIFY(!decoder.decode(batch, samples));
+}
+
+QTEST_GUILESS_MAIN(ParserBench)
+
+#include "tst_parserbench.moc"
@@ -0,0 +1,16 @@
+QT       += testlib
+QT       -= gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../sampledecoder.cpp \
+    ../../samplesequencer.cpp \
+    tst_samplesequencer.cpp
+
+HEADERS += \
+    ../../sampledecoder.h \
+    ../../samplesequencer.h
@@ -0,0 +1,119 @@
+// Retry and give-up timing of the sample sequencer, driven by the clock
+// alone: no samples arrive after the gap, as at the end of a burst.
+
+#include <QtTest>
+
+#include "samplesequencer.h"
+
+class SequencerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void inOrder();
+    void retryWithoutData();
+    void recovered();
+
+private:
+    static QVector<SampleDecoder::Sample> samples(int first, int count);
+    static QVector<int> sequences(const QVector<SampleDecoder::Sample> &samples);
+};
+
+QVector<SampleDecoder::Sample> SequencerTest::samples(int first, int count)
+{
+    QVector<SampleDecoder::Sample> result;
+    for (int i = 0; i < count; i++) {
+        SampleDecoder::Sample sample = {};
+        sample.sequence = first + i;
+        sample.time = (first + i) * 0.0125;
+        result.push_back(sample);
+    }
+    return result;
+}
+
+QVector<int> SequencerTest::sequences(const QVector<SampleDecoder::Sample> &samples)
+{
+    QVector<int> result;
+    for (const SampleDecoder::Sample &sample : samples) result.push_back(sample.sequence);
+    return result;
+}
+
+void SequencerTest::inOrder()
+{
+    SampleSequencer sequencer;
+    QVector<SampleDecoder::Sample> released;
+
+    sequencer.add(samples(10, 3), 0);
+    sequencer.release(released, 0);
+    QCOMPARE(sequences(released), QVector<int>({10, 11, 12}));
+    QVERIFY(sequencer.idle());
+}
+
+void SequencerTest::retryWithoutData()
+{
+    SampleSequencer sequencer;
+    QVector<SampleDecoder::Sample> released;
+    QVector<SampleDecoder::Range> requests;
+
+    // Frame 2 is lost, frame 3 is the last one sent
+    sequencer.add(samples(0, 2), 0);
+    sequencer.addMissing({{2, 1}}, 0);
+    sequencer.add(samples(3, 1), 0);
+
+    sequencer.takeRequests(requests, 0);
+    QCOMPARE(requests.size(), 1);
+    QCOMPARE(int(requests[0].first), 2);
+    QCOMPARE(int(requests[0].count), 1);
+    sequencer.release(released, 0);
+    QCOMPARE(sequences(released), QVector<int>({0, 1}));
+
+    // Asked again every RETRY_MS, three times in all
+    const qint64 due[] = {300, 600};
+    for (qint64 now : due) {
+        requests.clear();
+        sequencer.takeRequests(requests, now - 1);
+        QVERIFY(requests.isEmpty());
+        sequencer.takeRequests(requests, now);
+        QCOMPARE(requests.size(), 1);
+    }
+
+    requests.clear();
+    sequencer.takeRequests(requests, 900);
+    QVERIFY(requests.isEmpty());
+
+    // Held back until the last request has had its time, then given up on
+    released.clear();
+    sequencer.release(released, 899);
+    QVERIFY(released.isEmpty());
+    QVERIFY(!sequencer.idle());
+
+    sequencer.release(released, 900);
+    QCOMPARE(sequences(released), QVector<int>({3}));
+    QCOMPARE(sequencer.droppedFrames(), 1u);
+    QVERIFY(sequencer.idle());
+}
+
+void SequencerTest::recovered()
+{
+    SampleSequencer sequencer;
+    QVector<SampleDecoder::Sample> released;
+    QVector<SampleDecoder::Range> requests;
+
+    sequencer.add(samples(0, 1), 0);
+    sequencer.addMissing({{1, 2}}, 0);
+    sequencer.add(samples(3, 1), 0);
+    sequencer.takeRequests(requests, 0);
+    sequencer.release(released, 0);
+
+    // The resent frames arrive after one retry
+    sequencer.add(samples(1, 2), 400);
+    released.clear();
+    sequencer.release(released, 400);
+    QCOMPARE(sequences(released), QVector<int>({1, 2, 3}));
+    QCOMPARE(sequencer.recoveredFrames(), 2u);
+    QCOMPARE(sequencer.droppedFrames(), 0u);
+}
+
+QTEST_GUILESS_MAIN(SequencerTest)
+
+#include "tst_samplesequencer.moc"
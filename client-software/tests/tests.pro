@@ -0,0 +1,7 @@
+# Tests and benchmarks, built apart from the application:
+#   qmake tests/tests.pro && make && make check
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    parserbench \
+    samplesequencer
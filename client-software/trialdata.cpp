@@ -0,0 +1,40 @@
+#include "trialdata.h"
+
+#include <QFile>
+#include <QTextStream>
+
+bool TrialData::writeCsv(const QString &fileName, double wallClockOffset, QString &error) const
+{
+    QFile file(fileName);
+
+    if (!file.open(QFile::WriteOnly | QFile::NewOnly)) {
+        error = file.errorString();
+        return false;
+    }
+
+    QTextStream stream(&file);
+
+    stream << "time,force,displacement,displacement_time,host_time,balance" << Qt::endl;
+
+    int n = time.length();
+    for (int i = 0; i < n; ++i) {
+        // Wall clock time, 0 if the clocks were not yet synchronized
+        double wallTime = hostTime[i];
+        if (wallTime > 0) wallTime += wallClockOffset;
+
+        // Microsecond resolution so force and displacement can be aligned
+        stream << QString::number(time[i], 'f', 6) << "," <<
+                  QString::number(force[i], 'f', 3) << "," <<
+                  QString::number(displacement[i], 'f', 2) << "," <<
+                  QString::number(displacementTime[i], 'f', 6) << "," <<
+                  QString::number(wallTime, 'f', 6) << "," <<
+                  QString::number(balance[i], 'f', 3) << Qt::endl;
+    }
+
+    file.close();
+    if (file.error() != QFile::NoError) {
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
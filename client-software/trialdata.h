@@ -0,0 +1,70 @@
+#ifndef TRIALDATA_H
+#define TRIALDATA_H
+
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+
+#include "sampledecoder.h"
+
+// Samples in columns, as plotted and written to the trial CSV files
+struct TrialData
+{
+    QVector<double> time;
+    QVector<double> force;
+    QVector<double> balance;
+    QVector<double> displacement;
+    QVector<double> displacementTime;
+    QVector<double> hostTime;
+
+    int length() const { return time.length(); }
+    bool isEmpty() const { return time.isEmpty(); }
+
+    void append(const SampleDecoder::Sample &sample)
+    {
+        time.push_back(sample.time);
+        force.push_back(sample.force);
+        balance.push_back(sample.balance);
+        displacement.push_back(sample.displacement);
+        displacementTime.push_back(sample.displacementTime);
+        hostTime.push_back(sample.hostTime);
+    }
+
+    // Insert in time order, returning the index of the sample. Only the
+    // lead-in of a burst, sent after the heartbeats it overlaps, lands
+    // anywhere but the end.
+    int insertByTime(const SampleDecoder::Sample &sample)
+    {
+        int i = time.length();
+        while (i > 0 && time[i - 1] > sample.time) --i;
+
+        time.insert(i, sample.time);
+        force.insert(i, sample.force);
+        balance.insert(i, sample.balance);
+        displacement.insert(i, sample.displacement);
+        displacementTime.insert(i, sample.displacementTime);
+        hostTime.insert(i, sample.hostTime);
+        return i;
+    }
+
+    // Samples from start onwards
+    TrialData mid(int start) const
+    {
+        TrialData data;
+        data.time = time.mid(start);
+        data.force = force.mid(start);
+        data.balance = balance.mid(start);
+        data.displacement = displacement.mid(start);
+        data.displacementTime = displacementTime.mid(start);
+        data.hostTime = hostTime.mid(start);
+        return data;
+    }
+
+    // Write as a trial CSV file, which must not exist yet. Host times are
+    // written as wall clock times, adding wallClockOffset.
+    bool writeCsv(const QString &fileName, double wallClockOffset, QString &error) const;
+};
+
+Q_DECLARE_METATYPE(TrialData)
+
+#endif // TRIALDATA_H
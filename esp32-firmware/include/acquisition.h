@@ -0,0 +1,43 @@
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "hx711_spi.h"
+#include "spsc_ring.h"
+
+#define MAX_LOADCELL_CHANNELS 2
+
+// A load cell input: the HX711 it is wired to, that HX711's DOUT pin and
+// the channel and gain to read it at
+struct LoadCellChannel {
+  Hx711Spi *adc;
+  int dout_pin;
+  Hx711Gain gain;
+};
+
+// One HX711 conversion, timestamped when DOUT signalled data ready
+struct ForceReading {
+  uint64_t timestamp_us; // esp_timer time of the data-ready edge
+  int32_t counts;        // raw counts as at gain 128, tare offset not removed
+  uint8_t channel;       // index of the LoadCellChannel it was read from
+};
+
+#define FORCE_RING_SIZE 64
+
+// Conversions waiting to be processed by the consumer task
+extern SpscRing<ForceReading, FORCE_RING_SIZE> force_ring;
+
+// Conversions dropped because force_ring was full
+extern volatile uint32_t force_overruns;
+
+// Start the acquisition task on the given core. It reads each HX711 every
+// time its DOUT falls and notifies the consumer task after each conversion.
+// Channels on the same HX711 are read in turn, dropping the conversions
+// taken while the input settles after each switch; channels on separate
+// HX711s are each read at the full conversion rate.
+void startAcquisition(const LoadCellChannel *channels, int count, BaseType_t core,
+                      TaskHandle_t consumer);
+
+#endif // ACQUISITION_H
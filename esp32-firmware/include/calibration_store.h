@@ -0,0 +1,22 @@
+#ifndef CALIBRATION_STORE_H
+#define CALIBRATION_STORE_H
+
+#include <stdint.h>
+
+// Load cell scale factor and zero offset kept in NVS, so a power cycle can
+// start streaming straight away instead of waiting for a tare.
+
+// Stored scale factor, or fallback if none has been saved
+float loadCountsPerKg(float fallback);
+
+// Stored zero offset. Returns false if none has been saved.
+bool loadZeroOffset(int32_t &offset);
+
+// Stored zero offset of the right minus left balance, with two load cells.
+// Returns false if none has been saved.
+bool loadBalanceOffset(int32_t &offset);
+
+// Save all three. Writes flash, so call from a task that can afford to stall.
+void saveCalibration(float counts_per_kg, int32_t offset, int32_t balance_offset);
+
+#endif // CALIBRATION_STORE_H
@@ -0,0 +1,19 @@
+#ifndef CALIPER_H
+#define CALIPER_H
+
+#include "caliper_decoder.h"
+#include "spsc_ring.h"
+
+#define CALIPER_RING_SIZE 128 // five frames of clock edges
+
+// Clock edges waiting to be decoded by the sample task
+extern SpscRing<CaliperEdge, CALIPER_RING_SIZE> caliper_edges;
+
+// Edges dropped because caliper_edges was full
+extern volatile uint32_t caliper_overruns;
+
+// Capture the data line on every falling caliper clock edge. Must be called
+// from the core that should service the interrupt.
+void startCaliper(int clk_pin, int data_pin);
+
+#endif // CALIPER_H
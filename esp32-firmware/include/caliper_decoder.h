@@ -0,0 +1,68 @@
+#ifndef CALIPER_DECODER_H
+#define CALIPER_DECODER_H
+
+#include <stdint.h>
+
+// Level of the caliper data line sampled at one falling clock edge
+struct CaliperEdge {
+  uint64_t time_us; // esp_timer time of the edge
+  uint8_t data;     // raw DATA pin level (inverted by the level shifter)
+  uint8_t lost;     // nonzero if edges were dropped just before this one
+};
+
+// Assembles 24-bit caliper words from clock edges captured in interrupt
+// context. Bits arrive LSB first; a pause longer than FRAME_GAP_US between
+// edges, or a gap in the captured edges, starts a new frame, so a partial
+// frame never corrupts the next one.
+class CaliperDecoder {
+public:
+  static const int FRAME_BITS = 24;
+  static const uint32_t FRAME_GAP_US = 10000;
+
+  CaliperDecoder() { reset(); }
+
+  // Feed one falling clock edge. Returns true when a frame is complete.
+  bool feed(const CaliperEdge &edge) {
+    if (edge.lost || (bits > 0 && edge.time_us - last_us > FRAME_GAP_US)) {
+      bits = 0;
+    }
+    last_us = edge.time_us;
+
+    if (bits == 0) {
+      accumulator = 0;
+      start_us = edge.time_us;
+    }
+    if (!edge.data) accumulator |= 1UL << bits;
+    bits++;
+
+    if (bits < FRAME_BITS) return false;
+
+    frame_word = accumulator;
+    frame_us = start_us;
+    bits = 0;
+    return true;
+  }
+
+  void reset() {
+    bits = 0;
+    accumulator = 0;
+    last_us = 0;
+    start_us = 0;
+    frame_word = 0;
+    frame_us = 0;
+  }
+
+  // Last complete frame and the time of its first clock edge
+  uint32_t word() const { return frame_word; }
+  uint64_t timestamp() const { return frame_us; }
+
+private:
+  int bits;
+  uint32_t accumulator;
+  uint64_t last_us;
+  uint64_t start_us;
+  uint32_t frame_word;
+  uint64_t frame_us;
+};
+
+#endif // CALIPER_DECODER_H
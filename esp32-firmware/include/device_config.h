@@ -0,0 +1,65 @@
+#ifndef DEVICE_CONFIG_H
+#define DEVICE_CONFIG_H
+
+#include "force_filter.h"
+#include "protocol.h"
+
+// Pre-trigger history the firmware has room for, 24 bytes each
+#define MAX_PRETRIGGER_FRAMES 256 // 3.2 s at 80 SPS
+
+// Firmware defaults, used until the client writes a configuration
+inline DeviceConfig defaultConfig(float counts_per_kg, uint8_t load_cells = 1) {
+  DeviceConfig config;
+  config.version = CONFIG_VERSION;
+  config.averaging = 1;
+  config.median_taps = 3;
+  config.filter_order = 1;
+  config.decimation = 1;
+  config.batch_samples = 32;
+  config.sample_period_us = 50000;
+  config.batch_latency_us = 50000;
+  config.display_rate_hz = 10;
+  config.heartbeat_ms = 1000;
+  config.holdoff_ms = 250;
+  config.auto_zero_g = 0;
+  config.arm_force_kg = 0.1;
+  config.trigger_force_kg = 1.0;
+  config.counts_per_kg = counts_per_kg;
+  config.load_cells = load_cells;
+  config.pretrigger_frames = 64;
+  return config;
+}
+
+// Clamp a configuration written by the client to what the firmware supports.
+// The calibration and load cell count cannot be changed this way.
+inline DeviceConfig sanitizeConfig(DeviceConfig config, const DeviceConfig &active) {
+  config.version = CONFIG_VERSION;
+  if (config.averaging < 1) config.averaging = 1;
+  if (config.averaging > MAX_AVERAGING) config.averaging = MAX_AVERAGING;
+  if (config.median_taps < 1) config.median_taps = 1;
+  if (config.median_taps > MAX_MEDIAN_TAPS) config.median_taps = MAX_MEDIAN_TAPS;
+  if (config.median_taps % 2 == 0) config.median_taps--;
+  if (config.filter_order < 1) config.filter_order = 1;
+  if (config.filter_order > MAX_FILTER_ORDER) config.filter_order = MAX_FILTER_ORDER;
+  if (config.decimation < 1) config.decimation = 1;
+  if (config.decimation > MAX_DECIMATION) config.decimation = MAX_DECIMATION;
+  if (config.batch_samples < 1) config.batch_samples = 1;
+  if (config.batch_samples > 128) config.batch_samples = 128;
+  if (config.sample_period_us > 10000000) config.sample_period_us = 10000000;
+  if (config.batch_latency_us < 1000) config.batch_latency_us = 1000;
+  if (config.batch_latency_us > 1000000) config.batch_latency_us = 1000000;
+  if (config.display_rate_hz < 1) config.display_rate_hz = 1;
+  if (config.display_rate_hz > 60) config.display_rate_hz = 60;
+  if (config.heartbeat_ms < 100) config.heartbeat_ms = 100;
+  if (config.holdoff_ms > 10000) config.holdoff_ms = 10000;
+  if (config.auto_zero_g > 1000) config.auto_zero_g = 1000;
+  if (!(config.arm_force_kg > 0 && config.arm_force_kg < 1000)) config.arm_force_kg = active.arm_force_kg;
+  if (!(config.trigger_force_kg < 1000)) config.trigger_force_kg = active.trigger_force_kg;
+  if (!(config.trigger_force_kg >= config.arm_force_kg)) config.trigger_force_kg = config.arm_force_kg;
+  if (config.pretrigger_frames > MAX_PRETRIGGER_FRAMES) config.pretrigger_frames = MAX_PRETRIGGER_FRAMES;
+  config.counts_per_kg = active.counts_per_kg;
+  config.load_cells = active.load_cells;
+  return config;
+}
+
+#endif // DEVICE_CONFIG_H
@@ -0,0 +1,63 @@
+#ifndef DISPLAY_DIFF_H
+#define DISPLAY_DIFF_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Finds the parts of an SSD1306 framebuffer that changed since the last
+// flush. The buffer is laid out as in Adafruit_SSD1306: one byte per column
+// for each 8-pixel page. Changed columns are reported as runs within a page;
+// runs separated by fewer than MERGE_GAP unchanged columns are merged, since
+// each run costs a few bytes of addressing commands on the bus.
+template <int WIDTH, int HEIGHT>
+class DisplayDiff {
+public:
+  static const int PAGES = (HEIGHT + 7) / 8;
+  static const int MERGE_GAP = 8;
+
+  DisplayDiff() : valid(false) {}
+
+  // Force the next flush to send the whole frame
+  void invalidate() { valid = false; }
+
+  // Call send(page, first_col, last_col, data) for every changed run and
+  // remember the frame. Returns the number of data bytes sent.
+  template <typename Send>
+  int flush(const uint8_t *frame, Send send) {
+    int sent = 0;
+
+    for (int page = 0; page < PAGES; page++) {
+      const uint8_t *cur = frame + page * WIDTH;
+      uint8_t *old = shadow + page * WIDTH;
+
+      int first = -1;
+      int last = -1;
+      for (int col = 0; col < WIDTH; col++) {
+        if (valid && cur[col] == old[col]) continue;
+
+        if (first >= 0 && col - last > MERGE_GAP) {
+          send(page, first, last, cur + first);
+          sent += last - first + 1;
+          first = -1;
+        }
+        if (first < 0) first = col;
+        last = col;
+      }
+
+      if (first >= 0) {
+        send(page, first, last, cur + first);
+        sent += last - first + 1;
+      }
+    }
+
+    memcpy(shadow, frame, sizeof(shadow));
+    valid = true;
+    return sent;
+  }
+
+private:
+  uint8_t shadow[WIDTH * PAGES];
+  bool valid;
+};
+
+#endif // DISPLAY_DIFF_H
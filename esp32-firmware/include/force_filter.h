@@ -0,0 +1,140 @@
+#ifndef FORCE_FILTER_H
+#define FORCE_FILTER_H
+
+#include <stdint.h>
+
+#define MAX_MEDIAN_TAPS 5
+#define MAX_AVERAGING 16
+#define MAX_FILTER_ORDER 3
+#define MAX_DECIMATION 16
+
+// Integer filter chain for HX711 conversions. A median of the last few
+// conversions removes single-conversion spikes, a cascade of moving averages
+// (a CIC filter, normalised per stage) smooths what is left, and only every
+// decimation'th output is kept. Values between stages carry FRAC_BITS of
+// fraction so cascaded stages do not pile up rounding error. The output is
+// timestamped at the middle of the chain's window, so filtering does not
+// shift force against the caliper.
+class ForceFilter {
+public:
+  static const int FRAC_BITS = 8;
+
+  ForceFilter() { configure(1, 1, 1, 1); }
+
+  // Arguments must be within the MAX_* limits; median_taps should be odd
+  void configure(uint8_t median_taps, uint8_t averaging, uint8_t order, uint8_t decimation) {
+    taps = median_taps;
+    length = averaging;
+    stages = order;
+    factor = decimation;
+    reset();
+  }
+
+  void reset() {
+    median_count = 0;
+    median_next = 0;
+    for (int i = 0; i < MAX_FILTER_ORDER; i++) {
+      stage[i].sum = 0;
+      stage[i].count = 0;
+      stage[i].next = 0;
+    }
+    time_count = 0;
+    time_next = 0;
+    phase = 0;
+    output = 0;
+    output_us = 0;
+  }
+
+  // Add a conversion. Returns true if an output is due after decimation;
+  // value() is updated either way.
+  bool push(int32_t counts, uint64_t timestamp_us) {
+    times[time_next] = timestamp_us;
+    time_next = (time_next + 1) % TIME_HISTORY;
+    if (time_count < TIME_HISTORY) time_count++;
+
+    int64_t x = (int64_t)median(counts) << FRAC_BITS;
+    for (int i = 0; i < stages; i++) x = stage[i].add(x, length);
+    output = (int32_t)((x + (1 << (FRAC_BITS - 1))) >> FRAC_BITS);
+
+    // Each moving average delays by (length - 1) / 2 conversions, the
+    // median by (taps - 1) / 2. Counted in half conversions.
+    unsigned delay = (taps - 1) + stages * (length - 1);
+    output_us = (timeBack(delay / 2) + timeBack((delay + 1) / 2)) / 2;
+
+    bool due = phase == 0;
+    phase = (phase + 1) % factor;
+    return due;
+  }
+
+  // Latest filtered counts and the time they represent
+  int32_t value() const { return output; }
+  uint64_t timestamp() const { return output_us; }
+
+private:
+  // Enough for the longest delay the limits allow
+  static const int TIME_HISTORY = 32;
+
+  struct Stage {
+    int64_t window[MAX_AVERAGING];
+    int64_t sum;
+    uint8_t count;
+    uint8_t next;
+
+    // Running mean over the last length inputs, fewer while filling up
+    int64_t add(int64_t x, uint8_t length) {
+      if (count == length) {
+        sum -= window[next];
+      } else {
+        count++;
+      }
+      window[next] = x;
+      sum += x;
+      next = (next + 1) % length;
+      return sum >= 0 ? (sum + count / 2) / count : -((-sum + count / 2) / count);
+    }
+  };
+
+  uint8_t taps;
+  uint8_t length;
+  uint8_t stages;
+  uint8_t factor;
+
+  int32_t median_window[MAX_MEDIAN_TAPS];
+  uint8_t median_count;
+  uint8_t median_next;
+
+  Stage stage[MAX_FILTER_ORDER];
+
+  uint64_t times[TIME_HISTORY];
+  uint8_t time_count;
+  uint8_t time_next;
+
+  uint8_t phase;
+  int32_t output;
+  uint64_t output_us;
+
+  int32_t median(int32_t counts) {
+    median_window[median_next] = counts;
+    median_next = (median_next + 1) % taps;
+    if (median_count < taps) median_count++;
+    if (median_count == 1) return counts;
+
+    // Insertion sort, at most five values
+    int32_t sorted[MAX_MEDIAN_TAPS];
+    for (int i = 0; i < median_count; i++) {
+      int32_t v = median_window[i];
+      int j = i;
+      for (; j > 0 && sorted[j - 1] > v; j--) sorted[j] = sorted[j - 1];
+      sorted[j] = v;
+    }
+    return sorted[median_count / 2];
+  }
+
+  // Timestamp of the conversion back conversions ago, or the oldest kept
+  uint64_t timeBack(unsigned back) const {
+    if (back >= time_count) back = time_count - 1;
+    return times[(time_next + TIME_HISTORY - 1 - back) % TIME_HISTORY];
+  }
+};
+
+#endif // FORCE_FILTER_H
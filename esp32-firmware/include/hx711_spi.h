@@ -0,0 +1,57 @@
+#ifndef HX711_SPI_H
+#define HX711_SPI_H
+
+#include <stdint.h>
+
+#include <driver/spi_master.h>
+
+// Channel and gain of the next conversion, set by the number of clock
+// pulses after the 24 data bits
+enum Hx711Gain {
+  HX711_GAIN_A128 = 1,
+  HX711_GAIN_B32 = 2,
+  HX711_GAIN_A64 = 3,
+};
+
+// Sign-extend the 24 data bits, most significant byte first
+inline int32_t hx711Decode(const uint8_t data[3]) {
+  uint32_t raw = ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+  return (int32_t)(raw << 8) >> 8;
+}
+
+// Scale counts read at a gain to what channel A at gain 128 would read, so
+// channels can be added together
+inline int32_t hx711Normalize(int32_t counts, Hx711Gain gain) {
+  if (gain == HX711_GAIN_A64) return counts * 2;
+  if (gain == HX711_GAIN_B32) return counts * 4;
+  return counts;
+}
+
+// HX711 read through an SPI peripheral instead of bit-banging PD_SCK with
+// interrupts disabled. PD_SCK is the SPI clock and DOUT is MISO, so the whole
+// read is one transfer of 25-27 clocks timed by hardware, and the caliper
+// and other interrupts keep running while it is in progress. DOUT can still
+// be watched for the data-ready edge.
+class Hx711Spi {
+public:
+  Hx711Spi() : device(NULL), gain(HX711_GAIN_A128) {}
+
+  // The HX711 powers up on channel A at gain 128; any other gain takes
+  // effect from the conversion after the first read. Each HX711 needs an
+  // SPI host of its own, as DOUT is the bus's only input.
+  bool begin(int dout_pin, int sck_pin, Hx711Gain gain = HX711_GAIN_A128,
+             spi_host_device_t host = SPI2_HOST);
+
+  // Gain for the conversion after the next read
+  void setGain(Hx711Gain g) { gain = g; }
+  Hx711Gain getGain() const { return gain; }
+
+  // Shift out a conversion. DOUT must already be low.
+  int32_t read();
+
+private:
+  spi_device_handle_t device;
+  Hx711Gain gain;
+};
+
+#endif // HX711_SPI_H
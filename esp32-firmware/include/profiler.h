@@ -0,0 +1,42 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include <stddef.h>
+
+#include "stage_profile.h"
+
+// Pipeline stages timed with the CPU cycle counter. Each is recorded by the
+// task that runs it, which is pinned, so start and end come from the same
+// core's counter. Data-ready latency is recorded in microseconds instead,
+// as it spans an interrupt and a task.
+enum Stage {
+  STAGE_HX711_READ,      // acquisition: SPI readout of one conversion
+  STAGE_READY_LATENCY,   // data-ready edge to the sample task picking it up
+  STAGE_CALIPER_DECODE,  // sample: decoding queued caliper edges
+  STAGE_FORCE,           // sample: zero, filter, detector and frame for one conversion
+  STAGE_NOTIFY,          // transport: one notification
+  STAGE_RENDER,          // display: drawing the framebuffer
+  STAGE_OLED_FLUSH,      // display: sending changed runs over I2C
+  STAGE_LEDS,            // display: LED update
+  STAGE_NVS_SAVE,        // display: saving the tare offset
+  STAGE_COUNT
+};
+
+extern StageProfile stage_profiles[STAGE_COUNT];
+
+inline uint32_t cycleCount() { return ESP.getCycleCount(); }
+
+// Record the cycles since start against a stage
+inline void profileStage(Stage stage, uint32_t start) {
+  stage_profiles[stage].record(cycleCount() - start);
+}
+
+// One line per stage that ran: count, then min/avg/p99/max in microseconds.
+// Returns the length written, which fits in a BLE attribute.
+size_t formatProfile(char *out, size_t size);
+
+// Start all stages over, as of their next record
+void clearProfile();
+
+#endif // PROFILER_H
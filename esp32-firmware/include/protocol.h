@@ -0,0 +1,118 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+
+// Binary sample frame sent over the BLE data characteristic. All fields are
+// little-endian. The first byte is the protocol version so the client can
+// tell frames apart from the legacy "time,force,displacement" CSV text.
+// Version 2 frames lack balance_counts; 3-7 are packet types below.
+#define PROTOCOL_VERSION 8
+
+// Frame flags
+#define FRAME_FLAG_CALIPER_VALID 0x01 // caliper_word holds a received caliper frame
+#define FRAME_FLAG_TARED         0x02 // scale was tared since the previous frame
+#define FRAME_FLAG_OVERRUN       0x04 // frames were dropped on the device before this frame
+#define FRAME_FLAG_STREAMING     0x08 // part of a full-rate burst around a tamp
+#define FRAME_FLAG_HEARTBEAT     0x10 // low-rate frame sent while idle
+#define FRAME_FLAG_RATE_CHANGE   0x20 // first frame of a burst or the first one after it
+
+// Both timestamps come from the 64-bit esp_timer clock. Only the low 32 bits
+// of the HX711 conversion time are sent; the caliper frame time is sent
+// relative to it so the client can align force and displacement.
+struct __attribute__((packed)) SampleFrame {
+  uint8_t version;           // PROTOCOL_VERSION
+  uint8_t flags;             // FRAME_FLAG_*
+  uint16_t sequence;         // incremented for every frame, wraps at 65536
+  uint32_t timestamp_us;     // HX711 conversion time, wraps every ~71 minutes
+  int32_t force_counts;      // HX711 counts with the tare offset removed, all load cells
+  uint32_t caliper_word;     // raw 24-bit caliper word
+  int32_t caliper_offset_us; // caliper frame time minus timestamp_us
+  int32_t balance_counts;    // right minus left load cell, tared, 0 with one load cell
+};
+
+static_assert(sizeof(SampleFrame) == 24, "SampleFrame must be packed to 24 bytes");
+
+// Delta-compressed batches. Consecutive frames differ very little, so instead
+// of raw SampleFrames a notification can carry variable-length records:
+//
+//   packet: PACKET_VERSION_DELTA, sequence of the first record (uint16),
+//           then records back to back
+//   record: header byte (frame flags | RECORD_*), an unsigned varint of the
+//           frames skipped before it if RECORD_SKIP is set, then five varints
+//
+// A keyframe record holds the timestamp, zigzag force counts, caliper word,
+// zigzag caliper offset and zigzag balance counts. Other records hold zigzag
+// differences from the previous frame: timestamp interval minus the previous
+// interval, force counts, caliper word, caliper frame time (timestamp +
+// offset) and balance counts. Varints are little-endian base 128. A keyframe
+// is sent every KEYFRAME_INTERVAL frames, so a client that misses a packet
+// recovers at the next one. Versions 3 and 4 were the same packets without
+// the balance.
+#define PACKET_VERSION_DELTA 6
+#define PACKET_HEADER_SIZE 3
+
+// Frames resent on request use the same layout, but each packet starts with a
+// keyframe and stands alone, apart from the live stream
+#define PACKET_VERSION_RETRANSMIT 7
+
+// Reply to a CONTROL_PING, sent on the data characteristic. The client's
+// token is echoed with the device times the ping arrived and the reply left,
+// low 32 bits of the same clock as SampleFrame::timestamp_us, so the client
+// can estimate clock offset and drift NTP style.
+#define PACKET_VERSION_PONG 5
+
+struct __attribute__((packed)) PongPacket {
+  uint8_t version;      // PACKET_VERSION_PONG
+  uint32_t token;       // copied from the ping
+  uint32_t receive_us;  // ping arrival time
+  uint32_t transmit_us; // reply time
+};
+
+static_assert(sizeof(PongPacket) == 13, "PongPacket must be packed to 13 bytes");
+
+#define RECORD_FLAGS_MASK 0x3f // frame flags carried by the record
+#define RECORD_SKIP       0x40 // sequence numbers were skipped before this frame
+#define RECORD_KEYFRAME   0x80 // absolute values follow, not differences
+
+#define KEYFRAME_INTERVAL 32 // 0.4 s at 80 SPS
+
+// Control characteristic. Writes start with a CONTROL_* opcode; reads return
+// the active DeviceConfig.
+#define CONTROL_SET_CONFIG 0x01 // followed by a DeviceConfig
+#define CONTROL_RETRANSMIT 0x02 // followed by a first sequence number and count (uint16 each)
+#define CONTROL_PING       0x03 // followed by a uint32 token, answered with a PongPacket
+
+#define CONFIG_VERSION 6
+
+struct __attribute__((packed)) DeviceConfig {
+  uint8_t version;           // CONFIG_VERSION
+  uint8_t averaging;         // length of each moving average stage, in conversions
+  uint8_t median_taps;       // conversions in the spike filter median, 1 = off
+  uint8_t filter_order;      // moving average stages
+  uint8_t decimation;        // conversions per sample during a burst
+  uint16_t batch_samples;    // max samples per notification
+  uint32_t sample_period_us; // min time between samples at rest, 0 = every conversion
+  uint32_t batch_latency_us; // max time a sample waits in a batch
+  uint16_t display_rate_hz;  // OLED refresh rate
+  uint16_t heartbeat_ms;     // idle frame period
+  uint16_t holdoff_ms;       // time a burst continues after force drops below arm
+  uint16_t auto_zero_g;      // band around zero that auto-zero tracks within, 0 = off
+  float arm_force_kg;        // start/end of a full-rate burst
+  float trigger_force_kg;    // force that marks an actual tamp
+  float counts_per_kg;       // load cell calibration, read only
+  uint8_t load_cells;        // load cells summed into force_counts, read only
+  uint16_t pretrigger_frames; // idle frames sent ahead of a burst, up to MAX_PRETRIGGER_FRAMES
+};
+
+static_assert(sizeof(DeviceConfig) == 38, "DeviceConfig must be packed to 38 bytes");
+
+// Convert a raw caliper word to millimetres. Bits 0-19 hold the magnitude in
+// hundredths of a millimetre and bit 20 is the sign.
+inline float caliperWordToMm(uint32_t word) {
+  float mm = (word & ~(15UL << 20)) / 100.0f;
+  if (word & (1UL << 20)) mm = -mm;
+  return mm;
+}
+
+#endif // PROTOCOL_H
@@ -0,0 +1,87 @@
+#ifndef SAMPLE_BATCHER_H
+#define SAMPLE_BATCHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+#include "sample_codec.h"
+
+// Largest attribute value allowed by the ATT protocol
+#define BATCH_MAX_BYTES 512
+
+// Default ATT MTU before the client negotiates a larger one
+#define ATT_DEFAULT_MTU 23
+
+// Packs consecutive sample frames into a single notification payload as
+// delta-compressed records. The payload is flushed when the next record might
+// not fit, when the sample count limit is reached or when the oldest frame
+// has waited too long.
+class SampleBatcher {
+public:
+  explicit SampleBatcher(uint8_t version = PACKET_VERSION_DELTA)
+      : encoder(version), capacity(ATT_DEFAULT_MTU - 3), max_samples(1), max_latency_us(0),
+        count(0), length(0), first_us(0) {}
+
+  // Update the payload size from the negotiated ATT MTU
+  void setMtu(uint16_t mtu) {
+    size_t bytes = mtu > 3 ? mtu - 3 : 0;
+    if (bytes < PACKET_HEADER_SIZE + DeltaEncoder::MAX_RECORD_BYTES) {
+      bytes = PACKET_HEADER_SIZE + DeltaEncoder::MAX_RECORD_BYTES;
+    }
+    capacity = bytes < BATCH_MAX_BYTES ? bytes : BATCH_MAX_BYTES;
+  }
+
+  void setMaxSamples(uint16_t samples) { max_samples = samples > 0 ? samples : 1; }
+  void setMaxLatency(uint32_t us) { max_latency_us = us; }
+
+  // Append a frame. Returns true if the batch should be flushed now.
+  bool add(const SampleFrame &frame, uint32_t now_us) {
+    if (count == 0) {
+      first_us = now_us;
+      length = encoder.beginPacket(buffer, frame);
+    }
+    length += encoder.encode(buffer + length, frame);
+    count++;
+    return full();
+  }
+
+  // True once the sample limit is reached or the worst case record no longer
+  // fits
+  bool full() const {
+    return count >= max_samples || length + DeltaEncoder::MAX_RECORD_BYTES > capacity;
+  }
+
+  // True if the oldest frame in the batch has exceeded the latency budget
+  bool expired(uint32_t now_us) const {
+    return count > 0 && now_us - first_us >= max_latency_us;
+  }
+
+  bool empty() const { return count == 0; }
+  uint16_t samples() const { return count; }
+  const uint8_t *data() const { return buffer; }
+  size_t size() const { return length; }
+
+  void clear() {
+    count = 0;
+    length = 0;
+  }
+
+  // Drop any pending frames and restart the stream with a keyframe
+  void reset() {
+    clear();
+    encoder.reset();
+  }
+
+private:
+  uint8_t buffer[BATCH_MAX_BYTES];
+  DeltaEncoder encoder;
+  size_t capacity;
+  uint16_t max_samples;
+  uint32_t max_latency_us;
+  uint16_t count;
+  size_t length;
+  uint32_t first_us;
+};
+
+#endif // SAMPLE_BATCHER_H
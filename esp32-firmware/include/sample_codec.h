@@ -0,0 +1,223 @@
+#ifndef SAMPLE_CODEC_H
+#define SAMPLE_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+// Varint and zigzag helpers for the delta-compressed packet format. All
+// arithmetic wraps at 32 bits so encoding is lossless for any frame.
+
+inline uint32_t zigzagEncode(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+inline int32_t zigzagDecode(uint32_t value) {
+  return (int32_t)((value >> 1) ^ (0U - (value & 1)));
+}
+
+inline size_t putVarint(uint8_t *out, uint32_t value) {
+  size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)value | 0x80;
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+// Read a varint from [*in, end). Returns false if it is truncated or too long.
+inline bool getVarint(const uint8_t **in, const uint8_t *end, uint32_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 35 && *in < end; shift += 7) {
+    uint8_t byte = *(*in)++;
+    value |= (uint32_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+// State shared by both ends of the stream: the last frame and timestamp
+// interval, which the next record is a difference from.
+struct CodecState {
+  uint32_t timestamp_us;
+  uint32_t interval_us;
+  int32_t force_counts;
+  uint32_t caliper_word;
+  uint32_t caliper_us; // timestamp_us + caliper_offset_us
+  int32_t balance_counts;
+
+  void update(const SampleFrame &frame) {
+    interval_us = frame.timestamp_us - timestamp_us;
+    timestamp_us = frame.timestamp_us;
+    force_counts = frame.force_counts;
+    caliper_word = frame.caliper_word;
+    caliper_us = frame.timestamp_us + (uint32_t)frame.caliper_offset_us;
+    balance_counts = frame.balance_counts;
+  }
+};
+
+// Encodes frames as delta records, starting with a keyframe and then one
+// every keyframe interval.
+class DeltaEncoder {
+public:
+  // Header, skip count and five 32-bit varints
+  static const size_t MAX_RECORD_BYTES = 1 + 3 + 5 * 5;
+
+  explicit DeltaEncoder(uint8_t version = PACKET_VERSION_DELTA)
+      : packet_version(version), interval(KEYFRAME_INTERVAL) {
+    reset();
+  }
+
+  void setKeyframeInterval(uint16_t frames) { interval = frames > 0 ? frames : 1; }
+
+  // Start again with a keyframe, e.g. for a new client
+  void reset() {
+    since_keyframe = interval;
+    next_sequence = 0;
+    started = false;
+  }
+
+  // Write the header of a packet whose first record will be frame. The
+  // header carries the sequence following on from the previous packet, so
+  // frames dropped in between are a skip in the first record rather than a
+  // gap the decoder would take for a lost packet.
+  size_t beginPacket(uint8_t *out, const SampleFrame &frame) {
+    if (!started) next_sequence = frame.sequence;
+    started = true;
+    out[0] = packet_version;
+    out[1] = (uint8_t)next_sequence;
+    out[2] = (uint8_t)(next_sequence >> 8);
+    return PACKET_HEADER_SIZE;
+  }
+
+  // Append one record, at most MAX_RECORD_BYTES
+  size_t encode(uint8_t *out, const SampleFrame &frame) {
+    bool keyframe = since_keyframe >= interval;
+    uint16_t skipped = frame.sequence - next_sequence;
+    size_t n = 1;
+
+    out[0] = frame.flags & RECORD_FLAGS_MASK;
+    if (keyframe) out[0] |= RECORD_KEYFRAME;
+    if (skipped) {
+      out[0] |= RECORD_SKIP;
+      n += putVarint(out + n, skipped);
+    }
+
+    if (keyframe) {
+      n += putVarint(out + n, frame.timestamp_us);
+      n += putVarint(out + n, zigzagEncode(frame.force_counts));
+      n += putVarint(out + n, frame.caliper_word);
+      n += putVarint(out + n, zigzagEncode(frame.caliper_offset_us));
+      n += putVarint(out + n, zigzagEncode(frame.balance_counts));
+      state.interval_us = 0;
+      state.timestamp_us = frame.timestamp_us;
+      since_keyframe = 0;
+    } else {
+      uint32_t caliper_us = frame.timestamp_us + (uint32_t)frame.caliper_offset_us;
+      n += putVarint(out + n, zigzagEncode(frame.timestamp_us - state.timestamp_us - state.interval_us));
+      n += putVarint(out + n, zigzagEncode((uint32_t)frame.force_counts - (uint32_t)state.force_counts));
+      n += putVarint(out + n, zigzagEncode(frame.caliper_word - state.caliper_word));
+      n += putVarint(out + n, zigzagEncode(caliper_us - state.caliper_us));
+      n += putVarint(out + n, zigzagEncode((uint32_t)frame.balance_counts - (uint32_t)state.balance_counts));
+    }
+
+    state.update(frame);
+    next_sequence = frame.sequence + 1;
+    started = true;
+    since_keyframe++;
+    return n;
+  }
+
+private:
+  uint8_t packet_version;
+  uint16_t interval;
+  uint16_t since_keyframe;
+  uint16_t next_sequence;
+  bool started;
+  CodecState state;
+};
+
+// Decodes delta packets back into frames. Used by the simulator and
+// benchmarks; the client has its own copy in SampleDecoder. Live and
+// retransmitted packets need a decoder each.
+class DeltaDecoder {
+public:
+  DeltaDecoder() { reset(); }
+
+  // Drop the stream state and wait for the next keyframe
+  void reset() {
+    synced = false;
+    next_sequence = 0;
+    lost = 0;
+  }
+
+  // Frames that could not be decoded because a packet was missed
+  uint32_t lostFrames() const { return lost; }
+
+  // Decode one packet, calling emit(frame) for each frame recovered. Returns
+  // false if the packet is malformed.
+  template <typename Emit>
+  bool decode(const uint8_t *data, size_t length, Emit emit) {
+    if (length < PACKET_HEADER_SIZE) return false;
+    if (data[0] != PACKET_VERSION_DELTA && data[0] != PACKET_VERSION_RETRANSMIT) return false;
+
+    // Records only follow on from the previous packet if none was missed.
+    // Retransmitted packets always start afresh.
+    uint16_t sequence = data[1] | (data[2] << 8);
+    if (sequence != next_sequence || data[0] == PACKET_VERSION_RETRANSMIT) synced = false;
+
+    const uint8_t *in = data + PACKET_HEADER_SIZE;
+    const uint8_t *end = data + length;
+    while (in < end) {
+      uint8_t header = *in++;
+      uint32_t skipped = 0;
+      uint32_t values[5];
+      if ((header & RECORD_SKIP) && !getVarint(&in, end, skipped)) return false;
+      for (int i = 0; i < 5; i++) {
+        if (!getVarint(&in, end, values[i])) return false;
+      }
+      sequence += skipped;
+
+      SampleFrame frame;
+      frame.version = PROTOCOL_VERSION;
+      frame.flags = header & RECORD_FLAGS_MASK;
+      frame.sequence = sequence++;
+
+      if (header & RECORD_KEYFRAME) {
+        frame.timestamp_us = values[0];
+        frame.force_counts = zigzagDecode(values[1]);
+        frame.caliper_word = values[2];
+        frame.caliper_offset_us = zigzagDecode(values[3]);
+        frame.balance_counts = zigzagDecode(values[4]);
+        state.interval_us = 0;
+        state.timestamp_us = frame.timestamp_us;
+        synced = true;
+      } else if (synced) {
+        frame.timestamp_us = state.timestamp_us + state.interval_us + zigzagDecode(values[0]);
+        frame.force_counts = (int32_t)((uint32_t)state.force_counts + zigzagDecode(values[1]));
+        frame.caliper_word = state.caliper_word + zigzagDecode(values[2]);
+        frame.caliper_offset_us = (int32_t)(state.caliper_us + zigzagDecode(values[3]) - frame.timestamp_us);
+        frame.balance_counts = (int32_t)((uint32_t)state.balance_counts + zigzagDecode(values[4]));
+      } else {
+        lost++;
+        continue;
+      }
+
+      state.update(frame);
+      emit(frame);
+    }
+
+    next_sequence = sequence;
+    return true;
+  }
+
+private:
+  bool synced;
+  uint16_t next_sequence;
+  uint32_t lost;
+  CodecState state;
+};
+
+#endif // SAMPLE_CODEC_H
@@ -0,0 +1,96 @@
+#ifndef STAGE_PROFILE_H
+#define STAGE_PROFILE_H
+
+#include <stdint.h>
+
+// Histogram of the time one pipeline stage takes. Values fall into
+// power-of-two ranges split into SUB_BUCKETS linear steps, so a percentile
+// is exact below SUB_BUCKETS and within 25% above it, in a fixed few
+// hundred bytes. Recording is done by one task only; another task may read
+// a summary while it runs, at the cost of an occasional count being off by
+// one, and clearing is left to the recording task so it never races.
+class StageProfile {
+public:
+  static const int SUB_BITS = 2;
+  static const int SUB_BUCKETS = 1 << SUB_BITS;
+  static const int BUCKETS = (32 - SUB_BITS + 1) * SUB_BUCKETS;
+
+  struct Summary {
+    uint32_t count;
+    uint32_t min;
+    uint32_t avg;
+    uint32_t p99;
+    uint32_t max;
+  };
+
+  StageProfile() : clear_requested(0), cleared(0) { reset(); }
+
+  void record(uint32_t value) {
+    if (cleared != clear_requested) {
+      reset();
+      cleared = clear_requested;
+    }
+
+    count++;
+    sum += value;
+    if (value < min) min = value;
+    if (value > max) max = value;
+    buckets[bucket(value)]++;
+  }
+
+  // Start over from the next record()
+  void clear() { clear_requested++; }
+
+  Summary summary() const {
+    Summary s = {0, 0, 0, 0, 0};
+    if (cleared != clear_requested || count == 0) return s; // nothing recorded since a clear
+    s.count = count;
+    s.min = min;
+    s.avg = (uint32_t)(sum / count);
+    s.max = max;
+
+    // Upper end of the bucket holding the 99th percentile
+    uint32_t rank = count - count / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+      seen += buckets[i];
+      if (seen < rank) continue;
+      s.p99 = upperBound(i) < max ? upperBound(i) : max;
+      break;
+    }
+    return s;
+  }
+
+private:
+  volatile uint32_t clear_requested;
+  uint32_t cleared;
+
+  uint32_t count;
+  uint64_t sum;
+  uint32_t min;
+  uint32_t max;
+  uint32_t buckets[BUCKETS];
+
+  void reset() {
+    count = 0;
+    sum = 0;
+    min = UINT32_MAX;
+    max = 0;
+    for (int i = 0; i < BUCKETS; i++) buckets[i] = 0;
+  }
+
+  static int bucket(uint32_t value) {
+    if (value < (uint32_t)SUB_BUCKETS) return value;
+    int shift = 31 - __builtin_clz(value) - SUB_BITS;
+    return (shift + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1));
+  }
+
+  static uint32_t upperBound(int index) {
+    if (index < SUB_BUCKETS) return index;
+    int shift = index / SUB_BUCKETS - 1;
+    uint32_t lower = (uint32_t)(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    return lower + ((1UL << shift) - 1);
+  }
+};
+
+#endif // STAGE_PROFILE_H
@@ -0,0 +1,152 @@
+#ifndef TAMP_DETECTOR_H
+#define TAMP_DETECTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+// Decides which frames are worth streaming. While idle only a heartbeat frame
+// is sent every so often, but the most recent idle frames are kept so a tamp
+// can be sent with its lead-in, up to CAPACITY of them. The thresholds mirror
+// the client's trigger: force rising past the arm level starts a burst at
+// full rate, rising past the trigger level marks an active tamp, and the
+// burst ends once force has stayed below the arm level for the hold-off time.
+template <size_t CAPACITY>
+class TampDetector {
+public:
+  enum State { IDLE, ARMED, ACTIVE, HOLDOFF };
+
+  TampDetector() : arm_counts(0), trigger_counts(0), heartbeat_us(1000000), holdoff_us(0),
+                   depth(CAPACITY), current(IDLE), count(0), next(0), last_heartbeat_us(0),
+                   release_us(0), rate_change(false), started(false) {}
+
+  void setThresholds(int32_t arm, int32_t trigger) {
+    arm_counts = arm;
+    trigger_counts = trigger;
+  }
+
+  void setHeartbeat(uint32_t period_us) { heartbeat_us = period_us; }
+  void setHoldoff(uint32_t period_us) { holdoff_us = period_us; }
+
+  // Idle frames to keep for the lead-in of a burst, 0 for none. A change
+  // starts the history afresh.
+  void setHistoryDepth(size_t frames) {
+    if (frames > CAPACITY) frames = CAPACITY;
+    if (frames == depth) return;
+    depth = frames;
+    count = 0;
+    next = 0;
+  }
+
+  State state() const { return current; }
+
+  // True if a conversion with these counts should be sampled at full rate:
+  // during a burst, or when it would start one
+  bool burst(int32_t force_counts) const {
+    return current != IDLE || force_counts >= arm_counts;
+  }
+
+  // Process one frame, calling emit(frame) for each frame that should be
+  // streamed. When a burst starts the buffered history that has not already
+  // gone out as heartbeats comes first, oldest first, so frames older than
+  // the last heartbeat follow it. The first frame of a burst and the first
+  // frame after one are flagged as rate changes.
+  template <typename Emit>
+  void process(SampleFrame frame, uint64_t time_us, Emit emit) {
+    switch (current) {
+    case IDLE:
+      if (frame.force_counts >= arm_counts) {
+        current = ARMED;
+        rate_change = true;
+        flushHistory(emit);
+        send(frame, FRAME_FLAG_STREAMING, emit);
+        last_heartbeat_us = time_us;
+      } else if (!started || time_us - last_heartbeat_us >= heartbeat_us) {
+        // The first frame goes out straight away, so the client sees the
+        // device is up. It stays in the history, marked as sent.
+        send(frame, FRAME_FLAG_HEARTBEAT, emit);
+        frame.flags |= FRAME_FLAG_HEARTBEAT;
+        remember(frame);
+        last_heartbeat_us = time_us;
+      } else {
+        remember(frame);
+      }
+      break;
+
+    case ARMED:
+    case ACTIVE:
+    case HOLDOFF:
+      if (frame.force_counts >= trigger_counts) {
+        current = ACTIVE;
+      } else if (frame.force_counts >= arm_counts) {
+        if (current == HOLDOFF) current = ARMED;
+      } else if (current != HOLDOFF) {
+        current = HOLDOFF;
+        release_us = time_us + holdoff_us;
+      } else if (time_us >= release_us) {
+        // Back to heartbeats, starting with this frame
+        current = IDLE;
+        rate_change = true;
+        send(frame, FRAME_FLAG_HEARTBEAT, emit);
+        last_heartbeat_us = time_us;
+        break;
+      }
+
+      send(frame, FRAME_FLAG_STREAMING, emit);
+      last_heartbeat_us = time_us;
+      break;
+    }
+  }
+
+private:
+  int32_t arm_counts;
+  int32_t trigger_counts;
+  uint32_t heartbeat_us;
+  uint32_t holdoff_us;
+
+  // Frames of history in use, up to CAPACITY
+  size_t depth;
+
+  State current;
+
+  // Pre-trigger history, oldest frame at index next - count. Heartbeats
+  // keep their flag, so a burst does not send them twice.
+  SampleFrame history[CAPACITY];
+  size_t count;
+  size_t next;
+
+  uint64_t last_heartbeat_us;
+  uint64_t release_us;
+  bool rate_change;
+  bool started;
+
+  template <typename Emit>
+  void send(SampleFrame frame, uint8_t flags, Emit emit) {
+    frame.flags |= flags;
+    if (rate_change) frame.flags |= FRAME_FLAG_RATE_CHANGE;
+    rate_change = false;
+    started = true;
+    emit(frame);
+  }
+
+  void remember(const SampleFrame &frame) {
+    if (depth == 0) return;
+    history[next] = frame;
+    next = (next + 1) % depth;
+    if (count < depth) count++;
+  }
+
+  template <typename Emit>
+  void flushHistory(Emit emit) {
+    if (count == 0) return;
+    size_t i = (next + depth - count) % depth;
+    for (; count > 0; count--) {
+      if (!(history[i].flags & FRAME_FLAG_HEARTBEAT)) send(history[i], FRAME_FLAG_STREAMING, emit);
+      i = (i + 1) % depth;
+    }
+    next = 0;
+  }
+};
+
+#endif // TAMP_DETECTOR_H
@@ -0,0 +1,122 @@
+#ifndef ZERO_TRACKER_H
+#define ZERO_TRACKER_H
+
+#include <stdint.h>
+
+// Keeps the HX711 zero offset without stopping acquisition. A tare averages
+// the next TARE_READINGS conversions, applying the running mean as it goes,
+// so samples keep flowing while the offset converges. Auto-zero, if enabled,
+// watches for windows where the force is steady within a small band around
+// zero and moves the offset a fraction of the way towards their mean, which
+// follows slow load cell drift without chasing a real load. A refine is a
+// tare that starts from a known offset, such as one restored at boot: the
+// offset holds until the average is in, and only moves if the scale looks
+// unloaded.
+class ZeroTracker {
+public:
+  static const int TARE_READINGS = 10;
+  static const int WINDOW = 80;       // conversions per auto-zero window, 1 s at 80 SPS
+  static const int GAIN_SHIFT = 3;    // each window moves 1/8 of the way
+  static const int FRAC_BITS = 8;
+
+  ZeroTracker() : offset_fp(0), band(0), refine_band(0), tare_count(TARE_READINGS), tare_sum(0),
+                  tared(false) {
+    resetWindow();
+  }
+
+  // Counts either side of zero the force must stay within for auto-zero,
+  // 0 to disable it
+  void setBand(int32_t counts) {
+    band = counts;
+    resetWindow();
+  }
+
+  void setOffset(int32_t counts) { offset_fp = (int64_t)counts << FRAC_BITS; }
+  int32_t offset() const { return (int32_t)(offset_fp >> FRAC_BITS); }
+
+  void startTare() {
+    refine_band = 0;
+    tare_count = 0;
+    tare_sum = 0;
+    resetWindow();
+  }
+
+  // Tare that keeps the current offset unless the average is within
+  // max_change counts of it
+  void startRefine(int32_t max_change) {
+    startTare();
+    refine_band = max_change;
+  }
+
+  bool taring() const { return tare_count < TARE_READINGS; }
+
+  // True once after a tare completes
+  bool takeTared() {
+    bool result = tared;
+    tared = false;
+    return result;
+  }
+
+  // Add a raw conversion. quiet is false while a tamp may be in progress,
+  // when auto-zero must leave the offset alone.
+  void add(int32_t counts, bool quiet) {
+    if (taring()) {
+      tare_sum += counts;
+      tare_count++;
+      int64_t mean_fp = (tare_sum << FRAC_BITS) / tare_count;
+      if (refine_band == 0) {
+        offset_fp = mean_fp;
+        if (!taring()) tared = true;
+      } else if (!taring()) {
+        int64_t change = (mean_fp - offset_fp) >> FRAC_BITS;
+        if (change >= -refine_band && change <= refine_band) {
+          offset_fp = mean_fp;
+          tared = true;
+        }
+      }
+      return;
+    }
+
+    if (band <= 0) return;
+    if (!quiet) {
+      resetWindow();
+      return;
+    }
+
+    int32_t residual = counts - offset();
+    if (residual < window_min) window_min = residual;
+    if (residual > window_max) window_max = residual;
+    window_sum += residual;
+    if (++window_count < WINDOW) return;
+
+    // Steady and near zero: nudge the offset towards the window mean
+    int64_t mean_fp = (window_sum << FRAC_BITS) / WINDOW;
+    if (window_min >= -band && window_max <= band) {
+      offset_fp += mean_fp >> GAIN_SHIFT;
+    }
+    resetWindow();
+  }
+
+private:
+  int64_t offset_fp; // offset with FRAC_BITS of fraction, so small steps add up
+  int32_t band;
+  int32_t refine_band; // 0 for a plain tare
+
+  int tare_count;
+  int64_t tare_sum;
+  bool tared;
+
+  int window_count;
+  int64_t window_sum;
+  int32_t window_min;
+  int32_t window_max;
+
+  void resetWindow() {
+    window_count = 0;
+    window_sum = 0;
+    window_min = INT32_MAX;
+    window_max = INT32_MIN;
+  }
+};
+
+#endif // ZERO_TRACKER_H
@@ -0,0 +1,9 @@
+#ifndef ADAFRUIT_GFX_H
+#define ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+#define BLACK 0
+#define WHITE 1
+
+#endif // ADAFRUIT_GFX_H
@@ -0,0 +1,104 @@
+#ifndef ADAFRUIT_SSD1306_H
+#define ADAFRUIT_SSD1306_H
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_COLUMNADDR 0x21
+#define SSD1306_PAGEADDR 0x22
+
+// Framebuffer-only SSD1306. Text is drawn with a synthetic 5x7 glyph per
+// character so renders and partial refreshes cost about what they do on the
+// device, and bus traffic is counted on the TwoWire it was given.
+class Adafruit_SSD1306 : public Print {
+public:
+  Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi, int8_t rst_pin = -1,
+                   uint32_t clk_during = 400000UL, uint32_t clk_after = 100000UL)
+      : width(w), height(h), wire(twi), buffer(NULL), rotation(0), size(1), cursor_x(0), cursor_y(0) {}
+
+  ~Adafruit_SSD1306() { delete[] buffer; }
+
+  bool begin(uint8_t vcs, uint8_t addr) {
+    buffer = new uint8_t[width * ((height + 7) / 8)];
+    clearDisplay();
+    return true;
+  }
+
+  void clearDisplay() { memset(buffer, 0, width * ((height + 7) / 8)); }
+  void setTextSize(uint8_t s) { size = s > 0 ? s : 1; }
+  void setTextColor(uint16_t c) {}
+  void setRotation(uint8_t r) { rotation = r & 3; }
+
+  void setCursor(int16_t x, int16_t y) {
+    cursor_x = x;
+    cursor_y = y;
+  }
+
+  uint8_t *getBuffer() { return buffer; }
+
+  void ssd1306_command(uint8_t c) {
+    wire->beginTransmission(0x3C);
+    wire->write((uint8_t)0x00);
+    wire->write(c);
+    wire->endTransmission();
+  }
+
+  // Full refresh: addressing commands plus the whole buffer
+  void display() {
+    for (int i = 0; i < 6; i++) ssd1306_command(0);
+    wire->beginTransmission(0x3C);
+    wire->write((uint8_t)0x40);
+    wire->write(buffer, width * ((height + 7) / 8));
+    wire->endTransmission();
+  }
+
+  size_t write(uint8_t c) {
+    if (c == '\n') {
+      cursor_x = 0;
+      cursor_y += size * 8;
+    } else if (c != '\r') {
+      drawChar(cursor_x, cursor_y, c);
+      cursor_x += size * 6;
+    }
+    return 1;
+  }
+  using Print::write;
+
+private:
+  uint8_t width;
+  uint8_t height;
+  TwoWire *wire;
+  uint8_t *buffer;
+  uint8_t rotation;
+  uint8_t size;
+  int16_t cursor_x;
+  int16_t cursor_y;
+
+  void drawPixel(int16_t x, int16_t y) {
+    int16_t t;
+    switch (rotation) {
+    case 1: t = x; x = width - 1 - y; y = t; break;
+    case 2: x = width - 1 - x; y = height - 1 - y; break;
+    case 3: t = x; x = y; y = height - 1 - t; break;
+    }
+    if (x < 0 || x >= width || y < 0 || y >= height) return;
+    buffer[x + (y / 8) * width] |= 1 << (y & 7);
+  }
+
+  void drawChar(int16_t x, int16_t y, uint8_t c) {
+    for (int col = 0; col < 5; col++) {
+      uint8_t line = (uint8_t)((c * 37 + col * 11) ^ (c >> 1)) & 0x7f;
+      for (int row = 0; row < 7; row++) {
+        if (!(line & (1 << row))) continue;
+        for (int i = 0; i < size; i++) {
+          for (int j = 0; j < size; j++) {
+            drawPixel(x + col * size + i, y + row * size + j);
+          }
+        }
+      }
+    }
+  }
+};
+
+#endif // ADAFRUIT_SSD1306_H
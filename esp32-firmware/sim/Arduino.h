@@ -0,0 +1,63 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+// Native build stand-in for the ESP32 Arduino core
+
+#include <stdio.h>
+
+#include "sim_hal.h"
+
+#define F(str) (str)
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+
+  size_t write(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) write(data[i]);
+    return len;
+  }
+
+  size_t print(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+
+  size_t print(long value) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%ld", value);
+    return print(buf);
+  }
+
+  size_t print(double value, int digits = 2) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", digits, value);
+    return print(buf);
+  }
+
+  size_t println() { return print("\r\n"); }
+
+  template <typename T>
+  size_t println(T value) { return print(value) + println(); }
+
+  size_t println(double value, int digits) { return print(value, digits) + println(); }
+};
+
+// Serial output goes to stderr so stdout is free for the frame stream
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud) {}
+  size_t write(uint8_t c) { return fputc(c, stderr) == EOF ? 0 : 1; }
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+// Cycle counter of a 240 MHz core, derived from the host clock
+class EspClass {
+public:
+  uint32_t getCycleCount();
+  uint32_t getCpuFreqMHz() { return 240; }
+};
+
+extern EspClass ESP;
+
+#endif // ARDUINO_H
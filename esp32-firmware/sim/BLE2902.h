@@ -0,0 +1,6 @@
+#ifndef BLE2902_H
+#define BLE2902_H
+
+#include <BLEDevice.h>
+
+#endif // BLE2902_H
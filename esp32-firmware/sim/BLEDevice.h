@@ -0,0 +1,130 @@
+#ifndef BLEDEVICE_H
+#define BLEDEVICE_H
+
+#include <Arduino.h>
+
+#include <map>
+#include <string>
+
+// Minimal ESP32 BLE stack. A single simulated central connects as soon as
+// advertising starts and negotiates the MTU given on the command line.
+// Notifications are written to the simulator's output stream.
+
+struct esp_ble_gatts_cb_param_t {
+  struct {
+    uint16_t conn_id;
+    uint16_t mtu;
+  } mtu;
+};
+
+class BLEServer;
+class BLECharacteristic;
+
+class BLECharacteristicCallbacks {
+public:
+  virtual ~BLECharacteristicCallbacks() {}
+  virtual void onRead(BLECharacteristic *characteristic) {}
+  virtual void onWrite(BLECharacteristic *characteristic) {}
+};
+
+class BLEServerCallbacks {
+public:
+  virtual ~BLEServerCallbacks() {}
+  virtual void onConnect(BLEServer *server) {}
+  virtual void onDisconnect(BLEServer *server) {}
+  virtual void onMtuChanged(BLEServer *server, esp_ble_gatts_cb_param_t *param) {}
+};
+
+class BLEDescriptor {
+public:
+  virtual ~BLEDescriptor() {}
+};
+
+class BLE2902 : public BLEDescriptor {};
+
+class BLECharacteristic {
+public:
+  static const uint32_t PROPERTY_READ = 1 << 0;
+  static const uint32_t PROPERTY_WRITE = 1 << 1;
+  static const uint32_t PROPERTY_NOTIFY = 1 << 2;
+  static const uint32_t PROPERTY_BROADCAST = 1 << 3;
+  static const uint32_t PROPERTY_INDICATE = 1 << 4;
+  static const uint32_t PROPERTY_WRITE_NR = 1 << 5;
+
+  BLECharacteristic(const char *uuid, uint32_t properties)
+      : uuid(uuid), properties(properties), callbacks(NULL) {}
+
+  void setValue(uint8_t *data, size_t length) { value.assign((const char *)data, length); }
+  void setValue(const std::string &data) { value = data; }
+  std::string getValue() { return value; }
+  void addDescriptor(BLEDescriptor *descriptor) {}
+  void setCallbacks(BLECharacteristicCallbacks *cb) { callbacks = cb; }
+  BLECharacteristicCallbacks *getCallbacks() { return callbacks; }
+  void notify(bool is_notification = true);
+  void indicate() { notify(false); }
+
+  const std::string uuid;
+  const uint32_t properties;
+
+private:
+  std::string value;
+  BLECharacteristicCallbacks *callbacks;
+};
+
+class BLEService {
+public:
+  BLECharacteristic *createCharacteristic(const char *uuid, uint32_t properties);
+  void start() {}
+
+private:
+  std::map<std::string, BLECharacteristic *> characteristics;
+};
+
+class BLEServer {
+public:
+  BLEServer() : callbacks(NULL) {}
+
+  BLEService *createService(const char *uuid) { return new BLEService(); }
+  void setCallbacks(BLEServerCallbacks *cb) { callbacks = cb; }
+  BLEServerCallbacks *getCallbacks() { return callbacks; }
+
+private:
+  BLEServerCallbacks *callbacks;
+};
+
+class BLEAdvertising {
+public:
+  void addServiceUUID(const char *uuid) {}
+  void setScanResponse(bool scan) {}
+  void setMinPreferred(uint16_t interval) {}
+};
+
+class BLEDevice {
+public:
+  static void init(const char *name) {}
+  static void setMTU(uint16_t mtu) { local_mtu = mtu; }
+  static uint16_t getMTU() { return local_mtu; }
+  static BLEServer *createServer();
+  static BLEAdvertising *getAdvertising();
+  static void startAdvertising();
+
+private:
+  static uint16_t local_mtu;
+};
+
+// Where notifications go, and how many were sent
+void simSetNotifyOutput(FILE *out);
+uint64_t simNotifyCount();
+uint64_t simNotifyBytes();
+
+// Time since boot of the first notification, -1 if none was sent
+int64_t simFirstNotifyUs();
+
+// MTU the simulated central asks for
+void simSetCentralMtu(uint16_t mtu);
+
+// Write to a characteristic as the simulated central would. Returns false
+// if no characteristic has that UUID.
+bool simWriteCharacteristic(const char *uuid, const std::string &value);
+
+#endif // BLEDEVICE_H
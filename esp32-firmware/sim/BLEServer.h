@@ -0,0 +1,6 @@
+#ifndef BLESERVER_H
+#define BLESERVER_H
+
+#include <BLEDevice.h>
+
+#endif // BLESERVER_H
@@ -0,0 +1,39 @@
+#ifndef PREFERENCES_H
+#define PREFERENCES_H
+
+#include <Arduino.h>
+
+#include <string>
+
+// NVS key-value store. Values live in memory, and in the file given to
+// simSetNvsPath() if any, so a later run sees them like a power cycle would.
+class Preferences {
+public:
+  Preferences() : open(false), read_only(true) {}
+  ~Preferences() { end(); }
+
+  bool begin(const char *name, bool readOnly = false);
+  void end();
+
+  bool isKey(const char *key);
+  bool remove(const char *key);
+  bool clear();
+
+  int32_t getInt(const char *key, int32_t defaultValue = 0);
+  float getFloat(const char *key, float defaultValue = NAN);
+  size_t putInt(const char *key, int32_t value);
+  size_t putFloat(const char *key, float value);
+
+private:
+  bool open;
+  bool read_only;
+  std::string space;
+
+  bool get(const char *key, void *value, size_t length);
+  size_t put(const char *key, const void *value, size_t length);
+};
+
+// File NVS contents are loaded from and saved to
+void simSetNvsPath(const char *path);
+
+#endif // PREFERENCES_H
@@ -0,0 +1,25 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <Arduino.h>
+
+// I2C bus that only counts what would have been sent
+class TwoWire {
+public:
+  TwoWire() : bytes(0), transactions(0) {}
+
+  void begin() {}
+  void setClock(uint32_t hz) {}
+  void beginTransmission(uint8_t address) { transactions++; bytes++; }
+  size_t write(uint8_t data) { bytes++; return 1; }
+  size_t write(const uint8_t *data, size_t len) { bytes += len; return len; }
+  uint8_t endTransmission(bool stop = true) { return 0; }
+
+  // Totals since start, including address bytes
+  uint64_t bytes;
+  uint64_t transactions;
+};
+
+extern TwoWire Wire;
+
+#endif // WIRE_H
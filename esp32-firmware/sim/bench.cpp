@@ -0,0 +1,197 @@
+// Microbenchmarks of the per-sample hot path: caliper decode, force
+// filtering, frame formatting, delta compression, batching and notify, and display
+// render/refresh.
+
+#include <Arduino.h>
+#include <Adafruit_SSD1306.h>
+#include <BLEDevice.h>
+
+#include <math.h>
+
+#include <chrono>
+#include <vector>
+
+#include "caliper_decoder.h"
+#include "display_diff.h"
+#include "force_filter.h"
+#include "protocol.h"
+#include "sample_batcher.h"
+#include "sample_codec.h"
+#include "sim_signals.h"
+#include "tamp_detector.h"
+
+// Display state and helpers from main.cpp
+extern float scale_val;
+extern float scale_val_max;
+extern float caliper_val;
+extern float caliper_val_max;
+extern Adafruit_SSD1306 display;
+extern DisplayDiff<128, 64> display_diff;
+void renderDisplay();
+void sendDisplayRun(int page, int first, int last, const uint8_t *data);
+
+static volatile uint32_t sink;
+
+// Time fn over the given iterations. Returns the total number of calls,
+// including warm-up.
+template <typename Fn>
+static long bench(const char *name, long iterations, Fn fn) {
+  // Warm up
+  for (long i = 0; i < iterations / 10 + 1; i++) fn(i);
+
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; i++) fn(i);
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  printf("%-32s %10.1f ns/op %12.0f op/s\n", name, ns / iterations, iterations * 1e9 / ns);
+  return iterations / 10 + 1 + iterations;
+}
+
+int runBenchmarks() {
+  // Recorded-style caliper waveform: one frame of falling clock edges
+  std::vector<CaliperEdge> edges;
+  uint32_t word = simCaliperWord(-12.34);
+  for (int bit = 0; bit < 24; bit++) {
+    CaliperEdge edge = {(uint64_t)bit * 13, (uint8_t)((word >> bit) & 1 ? 0 : 1), 0};
+    edges.push_back(edge);
+  }
+
+  CaliperDecoder decoder;
+  uint64_t frame_start = 0;
+  bench("caliper decode (24 edges)", 200000, [&](long i) {
+    frame_start += 20000;
+    for (CaliperEdge edge : edges) {
+      edge.time_us += frame_start;
+      decoder.feed(edge);
+    }
+    sink = decoder.word();
+  });
+
+  // Widest filter chain the configuration allows
+  ForceFilter filter;
+  filter.configure(MAX_MEDIAN_TAPS, MAX_AVERAGING, MAX_FILTER_ORDER, 1);
+  bench("force filter (widest chain)", 1000000, [&](long i) {
+    filter.push((int32_t)((i * 2654435761u) & 0xffff), (uint64_t)i * 12500);
+    sink = filter.value();
+  });
+
+  char csv[48];
+  bench("legacy CSV format", 1000000, [&](long i) {
+    sink = snprintf(csv, sizeof(csv), "%.1f,%.3f,%.2f", i / 80.0, 1.234 + i * 1e-6, -12.34);
+  });
+
+  SampleFrame frame = {};
+  bench("binary frame assembly", 1000000, [&](long i) {
+    frame.version = PROTOCOL_VERSION;
+    frame.sequence = (uint16_t)i;
+    frame.timestamp_us = (uint32_t)(i * 12500);
+    frame.force_counts = (int32_t)(i & 0xffff);
+    frame.caliper_word = word;
+    frame.caliper_offset_us = -5000;
+    sink = frame.force_counts;
+  });
+
+  TampDetector<64> detector;
+  detector.setThresholds(10000, 100000);
+  bench("tamp detector (idle)", 1000000, [&](long i) {
+    frame.force_counts = (int32_t)(i & 0xff);
+    detector.process(frame, i * 12500, [](const SampleFrame &f) { sink = f.sequence; });
+  });
+
+  // A few tamps sampled like the device does: 80 SPS with a little jitter and
+  // noise, caliper frames at 50 Hz
+  std::vector<SampleFrame> stream;
+  uint32_t noise = 1;
+  for (int n = 0; n < 80 * 9; n++) {
+    noise = noise * 1103515245 + 12345;
+    double t = n / 80.0 + (noise >> 16) % 20 * 1e-6;
+    double caliper_t = floor(t * 50) / 50;
+    SampleFrame f = {};
+    f.version = PROTOCOL_VERSION;
+    f.flags = FRAME_FLAG_CALIPER_VALID | FRAME_FLAG_STREAMING;
+    f.sequence = (uint16_t)n;
+    f.timestamp_us = (uint32_t)(t * 1e6);
+    f.force_counts = (int32_t)((simForceKg(t) + ((int)(noise >> 8) % 101 - 50) * 1e-4) * 57300 / 0.546);
+    f.caliper_word = simCaliperWord(simPositionMm(caliper_t));
+    f.caliper_offset_us = (int32_t)((caliper_t - t) * 1e6);
+    f.balance_counts = f.force_counts / 8; // a slightly tilted tamp
+    stream.push_back(f);
+  }
+
+  DeltaEncoder encoder;
+  uint8_t packet[BATCH_MAX_BYTES];
+  size_t encoded = 0;
+  long encodes = bench("delta encode per sample", 1000000, [&](long i) {
+    const SampleFrame &f = stream[i % stream.size()];
+    if (i % stream.size() == 0) encoder.reset();
+    size_t n = encoder.encode(packet, f);
+    encoded += n;
+    sink = n;
+  });
+  double bytes_per_sample = (double)encoded / encodes;
+  printf("%-32s %10.2f bytes/sample (raw frame: %d)\n", "delta record size",
+         bytes_per_sample, (int)sizeof(SampleFrame));
+  printf("%-32s %10.1f samples/notification at MTU 247 (raw: %d)\n", "delta batch size",
+         (247 - 3 - PACKET_HEADER_SIZE) / bytes_per_sample, (247 - 3) / (int)sizeof(SampleFrame));
+
+  // Whole stream as packets of one notification each
+  std::vector<std::vector<uint8_t>> packets;
+  encoder.reset();
+  for (size_t n = 0; n < stream.size(); ) {
+    size_t length = encoder.beginPacket(packet, stream[n]);
+    while (n < stream.size() && length + DeltaEncoder::MAX_RECORD_BYTES <= 244) {
+      length += encoder.encode(packet + length, stream[n++]);
+    }
+    packets.push_back(std::vector<uint8_t>(packet, packet + length));
+  }
+
+  DeltaDecoder delta_decoder;
+  size_t decoded = 0;
+  bool lossless = true;
+  bench("delta decode per packet", 100000, [&](long i) {
+    const std::vector<uint8_t> &p = packets[i % packets.size()];
+    if (i % packets.size() == 0) {
+      delta_decoder.reset();
+      decoded = 0;
+    }
+    delta_decoder.decode(p.data(), p.size(), [&](const SampleFrame &f) {
+      lossless &= !memcmp(&f, &stream[decoded++], sizeof(f));
+    });
+  });
+  printf("%-32s %10.1f samples/packet, round trip %s\n", "delta decode",
+         (double)stream.size() / packets.size(), lossless ? "lossless" : "MISMATCH");
+
+  SampleBatcher batcher;
+  batcher.setMtu(247);
+  batcher.setMaxSamples(32);
+  batcher.setMaxLatency(50000);
+  BLECharacteristic characteristic("bench", BLECharacteristic::PROPERTY_NOTIFY);
+  bench("batch + notify per sample", 1000000, [&](long i) {
+    if (batcher.add(frame, (uint32_t)(i * 12500))) {
+      characteristic.setValue((uint8_t *)batcher.data(), batcher.size());
+      characteristic.notify();
+      batcher.clear();
+    }
+  });
+
+  display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
+  bench("display render", 20000, [&](long i) {
+    scale_val = (i % 1500) / 100.0;
+    scale_val_max = 15;
+    caliper_val = 20 - (i % 800) / 100.0;
+    caliper_val_max = 20;
+    renderDisplay();
+  });
+
+  uint64_t before = Wire.bytes;
+  long refreshes = bench("display partial refresh", 20000, [&](long i) {
+    scale_val = (i % 1500) / 100.0;
+    caliper_val = 20 - (i % 800) / 100.0;
+    renderDisplay();
+    display_diff.flush(display.getBuffer(), sendDisplayRun);
+  });
+  printf("%-32s %10.1f bytes/refresh (full refresh: %d)\n", "partial refresh i2c traffic",
+         (double)(Wire.bytes - before) / refreshes, 128 * 64 / 8 + 1 + 6 * 3 + 1);
+
+  return 0;
+}
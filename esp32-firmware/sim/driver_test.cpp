@@ -0,0 +1,176 @@
+// Tests of the hardware drivers against the simulated devices: the HX711
+// SPI readout is checked bit for bit against the modelled bitstream, and the
+// caliper decoder is fed clock and data waveforms like those it captures.
+// The delta codec that carries the frames is checked here too.
+
+#include <Arduino.h>
+
+#include <vector>
+
+#include "caliper_decoder.h"
+#include "hx711_spi.h"
+#include "protocol.h"
+#include "sample_codec.h"
+#include "sim_signals.h"
+
+static const uint8_t TEST_DOUT_PIN = 17;
+static const uint8_t TEST_SCK_PIN = 16;
+
+static int failures = 0;
+
+static void check(bool ok, const char *what) {
+  printf("%-48s %s\n", what, ok ? "ok" : "FAIL");
+  if (!ok) failures++;
+}
+
+static void testDecode() {
+  const uint8_t max[3] = {0x7f, 0xff, 0xff};
+  const uint8_t min[3] = {0x80, 0x00, 0x00};
+  const uint8_t minus_one[3] = {0xff, 0xff, 0xff};
+  const uint8_t mixed[3] = {0x01, 0xe2, 0x40};
+  check(hx711Decode(max) == 0x7fffff, "decode: largest positive");
+  check(hx711Decode(min) == -0x800000, "decode: most negative");
+  check(hx711Decode(minus_one) == -1, "decode: -1");
+  check(hx711Decode(mixed) == 123456, "decode: byte order");
+  check(hx711Normalize(250, HX711_GAIN_B32) == 1000, "normalize: channel B");
+  check(hx711Normalize(-500, HX711_GAIN_A64) == -1000, "normalize: gain 64");
+}
+
+// Convert, then read it back through the driver
+static int32_t convertAndRead(Hx711Spi &adc, long channel_a, long channel_b = 0) {
+  simConvertLoadCell(0, channel_a, channel_b);
+  return adc.read();
+}
+
+static void testBitstream() {
+  simAttachLoadCell(0, TEST_DOUT_PIN);
+  Hx711Spi adc;
+  check(adc.begin(TEST_DOUT_PIN, TEST_SCK_PIN), "begin");
+
+  check(convertAndRead(adc, 123456) == 123456, "read: positive");
+  check(simLoadCellPulses(0) == 25, "read: 25 clocks at gain 128");
+  check(digitalRead(TEST_DOUT_PIN) == HIGH, "read: DOUT high afterwards");
+  check(convertAndRead(adc, -5) == -5, "read: negative");
+  check(convertAndRead(adc, 0) == 0, "read: zero");
+  check(convertAndRead(adc, 9000000) == 0x7fffff, "read: saturates high");
+  check(convertAndRead(adc, -9000000) == -0x800000, "read: saturates low");
+
+  // A gain change applies from the conversion after the read that sets it
+  adc.setGain(HX711_GAIN_A64);
+  check(convertAndRead(adc, 1000) == 1000, "gain A64: current conversion unchanged");
+  check(simLoadCellPulses(0) == 27, "gain A64: 27 clocks");
+  check(convertAndRead(adc, 1000) == 500, "gain A64: next conversion halved");
+
+  adc.setGain(HX711_GAIN_B32);
+  check(convertAndRead(adc, 1000, 4000) == 500, "channel B: current conversion on A");
+  check(simLoadCellPulses(0) == 26, "channel B: 26 clocks");
+  check(convertAndRead(adc, 1000, 4000) == 1000, "channel B: next conversion on B");
+
+  adc.setGain(HX711_GAIN_A128);
+  convertAndRead(adc, 1000, 4000);
+  check(convertAndRead(adc, 1000, 4000) == 1000, "gain A128: back on A");
+}
+
+// Caliper clock period within a frame
+static const uint64_t CALIPER_BIT_US = 13;
+
+// Falling clock edges of one caliper frame as the ISR captures them, with
+// the data line inverted by the level shifter
+static std::vector<CaliperEdge> caliperWaveform(uint32_t word, uint64_t start_us) {
+  std::vector<CaliperEdge> edges;
+  for (int bit = 0; bit < CaliperDecoder::FRAME_BITS; bit++) {
+    CaliperEdge edge;
+    edge.time_us = start_us + bit * CALIPER_BIT_US;
+    edge.data = (word >> bit) & 1 ? LOW : HIGH;
+    edge.lost = 0;
+    edges.push_back(edge);
+  }
+  return edges;
+}
+
+// Feed edges, counting completed frames
+static int feedCaliper(CaliperDecoder &decoder, const std::vector<CaliperEdge> &edges) {
+  int frames = 0;
+  for (const CaliperEdge &edge : edges) frames += decoder.feed(edge);
+  return frames;
+}
+
+static void testCaliper() {
+  CaliperDecoder decoder;
+  uint32_t word = simCaliperWord(12.34);
+  std::vector<CaliperEdge> edges = caliperWaveform(word, 1000);
+  check(feedCaliper(decoder, edges) == 1, "caliper: clean frame");
+  check(decoder.word() == word && decoder.timestamp() == 1000, "caliper: word and first edge time");
+  check(fabsf(caliperWordToMm(decoder.word()) - 12.34f) < 0.001f, "caliper: 12.34 mm");
+
+  // Sign in bit 20, magnitude below it
+  word = simCaliperWord(-3.21);
+  check(feedCaliper(decoder, caliperWaveform(word, 50000)) == 1 && decoder.word() == word,
+        "caliper: negative frame");
+  check(fabsf(caliperWordToMm(decoder.word()) + 3.21f) < 0.001f, "caliper: -3.21 mm");
+
+  // A pause of exactly FRAME_GAP_US inside a frame still belongs to it;
+  // any longer starts a new frame
+  word = simCaliperWord(7.5);
+  edges = caliperWaveform(word, 100000);
+  for (size_t i = 12; i < edges.size(); i++) edges[i].time_us += CaliperDecoder::FRAME_GAP_US - CALIPER_BIT_US;
+  check(feedCaliper(decoder, edges) == 1 && decoder.word() == word, "caliper: pause at FRAME_GAP_US");
+  edges = caliperWaveform(word, 200000);
+  for (size_t i = 12; i < edges.size(); i++) edges[i].time_us += CaliperDecoder::FRAME_GAP_US - CALIPER_BIT_US + 1;
+  check(feedCaliper(decoder, edges) == 0, "caliper: longer pause splits the frame");
+  check(feedCaliper(decoder, caliperWaveform(word, 300000)) == 1 && decoder.word() == word,
+        "caliper: next frame after the split");
+
+  // Edges dropped before the ring had room discard the partial frame
+  edges = caliperWaveform(simCaliperWord(1.0), 400000);
+  edges.resize(10);
+  std::vector<CaliperEdge> next = caliperWaveform(word, 400000 + 10 * CALIPER_BIT_US);
+  next[0].lost = 1;
+  edges.insert(edges.end(), next.begin(), next.end());
+  check(feedCaliper(decoder, edges) == 1 && decoder.word() == word, "caliper: lost edges restart the frame");
+
+  // A frame cut short completes nothing, and the next one decodes
+  edges = caliperWaveform(simCaliperWord(2.0), 500000);
+  edges.resize(20);
+  check(feedCaliper(decoder, edges) == 0, "caliper: truncated frame");
+  check(feedCaliper(decoder, caliperWaveform(word, 520000)) == 1 && decoder.word() == word,
+        "caliper: frame after a truncated one");
+}
+
+// Frames dropped between two packets are skipped by the first record of the
+// second, so the decoder stays in sync
+static void testDeltaSkip() {
+  DeltaEncoder encoder;
+  DeltaDecoder decoder;
+  uint8_t packet[64];
+  uint16_t sequences[] = {10, 11, 13, 14, 17};
+  uint16_t decoded[5];
+  int count = 0;
+
+  for (int n = 0; n < 5; n++) {
+    SampleFrame frame = {};
+    frame.version = PROTOCOL_VERSION;
+    frame.sequence = sequences[n];
+    frame.timestamp_us = sequences[n] * 12500;
+    frame.force_counts = n * 100;
+    size_t length = encoder.beginPacket(packet, frame);
+    length += encoder.encode(packet + length, frame);
+    decoder.decode(packet, length, [&](const SampleFrame &f) {
+      if (count < 5) decoded[count] = f.sequence;
+      count++;
+    });
+  }
+
+  check(count == 5 && decoder.lostFrames() == 0, "delta: skips between packets decode");
+  check(count == 5 && decoded[2] == 13 && decoded[4] == 17, "delta: skipped sequence numbers");
+}
+
+int runDriverTests() {
+  testDecode();
+  testBitstream();
+  testCaliper();
+  testDeltaSkip();
+
+  printf("%d failure%s\n", failures, failures == 1 ? "" : "s");
+  return failures ? 1 : 0;
+}
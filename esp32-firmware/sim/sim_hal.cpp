@@ -0,0 +1,414 @@
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <Preferences.h>
+#include <Wire.h>
+#include <driver/spi_master.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+TwoWire Wire;
+
+// Timing
+
+static const std::chrono::steady_clock::time_point boot = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time() {
+  auto elapsed = std::chrono::steady_clock::now() - boot;
+  return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+uint32_t micros() { return (uint32_t)esp_timer_get_time(); }
+uint32_t millis() { return (uint32_t)(esp_timer_get_time() / 1000); }
+
+uint32_t EspClass::getCycleCount() {
+  auto elapsed = std::chrono::steady_clock::now() - boot;
+  return (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() * 240 / 1000);
+}
+
+void delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// GPIO and interrupts. One recursive lock stands in for the interrupt
+// controller: handlers run with it held and critical sections take it too.
+
+static std::recursive_mutex interrupt_lock;
+static volatile int pin_levels[SIM_GPIO_COUNT];
+static void (*pin_handlers[SIM_GPIO_COUNT])(void);
+static void (*pin_arg_handlers[SIM_GPIO_COUNT])(void *);
+static void *pin_args[SIM_GPIO_COUNT];
+static int pin_modes[SIM_GPIO_COUNT];
+
+void simEnterCritical(portMUX_TYPE *mux) { interrupt_lock.lock(); }
+void simExitCritical(portMUX_TYPE *mux) { interrupt_lock.unlock(); }
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (mode == INPUT_PULLUP && pin < SIM_GPIO_COUNT) pin_levels[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin < SIM_GPIO_COUNT) pin_levels[pin] = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < SIM_GPIO_COUNT ? pin_levels[pin] : LOW;
+}
+
+int digitalPinToInterrupt(uint8_t pin) { return pin; }
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {
+  std::lock_guard<std::recursive_mutex> lock(interrupt_lock);
+  pin_handlers[pin] = handler;
+  pin_arg_handlers[pin] = NULL;
+  pin_modes[pin] = mode;
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode) {
+  std::lock_guard<std::recursive_mutex> lock(interrupt_lock);
+  pin_handlers[pin] = NULL;
+  pin_arg_handlers[pin] = handler;
+  pin_args[pin] = arg;
+  pin_modes[pin] = mode;
+}
+
+void simSetPin(uint8_t pin, int level) {
+  std::lock_guard<std::recursive_mutex> lock(interrupt_lock);
+  int old = pin_levels[pin];
+  pin_levels[pin] = level;
+
+  bool fell = old == HIGH && level == LOW;
+  bool rose = old == LOW && level == HIGH;
+  if (!(fell && (pin_modes[pin] & FALLING)) && !(rose && (pin_modes[pin] & RISING))) return;
+  if (pin_handlers[pin]) pin_handlers[pin]();
+  if (pin_arg_handlers[pin]) pin_arg_handlers[pin](pin_args[pin]);
+}
+
+uint32_t simGpioIn() {
+  uint32_t levels = 0;
+  for (int pin = 0; pin < 32; pin++) {
+    if (pin_levels[pin]) levels |= 1UL << pin;
+  }
+  return levels;
+}
+
+// SPI master. Transfers run straight through the attached device model;
+// the bus and device settings only matter to real hardware.
+
+struct SimSpiDevice {
+  spi_host_device_t host;
+};
+
+static const int SIM_SPI_HOSTS = 3;
+static SimSpiTransfer spi_models[SIM_SPI_HOSTS];
+static bool spi_buses[SIM_SPI_HOSTS];
+
+void simAttachSpiDevice(spi_host_device_t host, SimSpiTransfer transfer) { spi_models[host] = transfer; }
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *bus, spi_dma_chan_t dma) {
+  if (spi_buses[host]) return ESP_ERR_INVALID_STATE;
+  spi_buses[host] = true;
+  return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *config,
+                             spi_device_handle_t *handle) {
+  if (!spi_buses[host]) return ESP_ERR_INVALID_STATE;
+  *handle = new SimSpiDevice{host};
+  return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *transaction) {
+  SimSpiTransfer model = spi_models[handle->host];
+  if (!model) return ESP_FAIL;
+  bool inline_data = transaction->flags & (SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA);
+  if (inline_data && transaction->length > 32) return ESP_FAIL;
+
+  const uint8_t *tx = transaction->flags & SPI_TRANS_USE_TXDATA ? transaction->tx_data
+                                                               : (const uint8_t *)transaction->tx_buffer;
+  uint8_t *rx = transaction->flags & SPI_TRANS_USE_RXDATA ? transaction->rx_data
+                                                         : (uint8_t *)transaction->rx_buffer;
+  model(tx, rx, transaction->length);
+  return ESP_OK;
+}
+
+// FreeRTOS tasks as threads, with task notifications as counting semaphores
+
+struct SimTask {
+  const char *name;
+  std::mutex mutex;
+  std::condition_variable cv;
+  uint32_t notifications = 0;
+};
+
+struct SimTaskDeleted {};
+
+static thread_local SimTask *current_task = NULL;
+
+static SimTask *currentTask() {
+  if (!current_task) current_task = new SimTask();
+  return current_task;
+}
+
+static void runTask(SimTask *task, TaskFunction_t fn, void *param) {
+  current_task = task;
+  try {
+    fn(param);
+  } catch (const SimTaskDeleted &) {
+  }
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack,
+                                   void *param, UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core) {
+  SimTask *task = new SimTask();
+  task->name = name;
+  if (handle) *handle = task;
+  std::thread(runTask, task, fn, param).detach();
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  // Only self-deletion is used by the firmware
+  throw SimTaskDeleted();
+}
+
+TickType_t xTaskGetTickCount() {
+  return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  delay(ticks);
+}
+
+void vTaskDelayUntil(TickType_t *previous, TickType_t increment) {
+  *previous += increment;
+  auto wake = boot + std::chrono::milliseconds(*previous);
+  std::this_thread::sleep_until(wake);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) {
+  SimTask *task = currentTask();
+  std::unique_lock<std::mutex> lock(task->mutex);
+
+  auto ready = [task] { return task->notifications > 0; };
+  if (wait == portMAX_DELAY) {
+    task->cv.wait(lock, ready);
+  } else {
+    task->cv.wait_for(lock, std::chrono::milliseconds(wait), ready);
+  }
+
+  uint32_t count = task->notifications;
+  if (count > 0) task->notifications = clear ? 0 : count - 1;
+  return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notifications++;
+  }
+  task->cv.notify_one();
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+  xTaskNotifyGive(task);
+  if (woken) *woken = pdTRUE;
+}
+
+extern void loop();
+
+static void loopTask(void *param) {
+  for (;;) {
+    loop();
+  }
+}
+
+void simStartLoopTask() {
+  xTaskCreatePinnedToCore(loopTask, "loopTask", 8192, NULL, 1, NULL, 1);
+}
+
+// BLE
+
+uint16_t BLEDevice::local_mtu = 23;
+
+static BLEServer *server = NULL;
+static BLEAdvertising advertising;
+static uint16_t central_mtu = 247;
+
+static std::mutex notify_mutex;
+static FILE *notify_output = NULL;
+static uint64_t notify_count = 0;
+static uint64_t notify_bytes = 0;
+static int64_t first_notify_us = -1;
+
+void simSetNotifyOutput(FILE *out) { notify_output = out; }
+uint64_t simNotifyCount() { return notify_count; }
+uint64_t simNotifyBytes() { return notify_bytes; }
+int64_t simFirstNotifyUs() { return first_notify_us; }
+void simSetCentralMtu(uint16_t mtu) { central_mtu = mtu; }
+
+// Each notification is written as a little-endian 16-bit length and payload
+void BLECharacteristic::notify(bool is_notification) {
+  std::lock_guard<std::mutex> lock(notify_mutex);
+  if (notify_count == 0) first_notify_us = esp_timer_get_time();
+  notify_count++;
+  notify_bytes += value.size();
+
+  if (notify_output) {
+    uint8_t header[2] = {(uint8_t)(value.size() & 0xff), (uint8_t)(value.size() >> 8)};
+    fwrite(header, 1, sizeof(header), notify_output);
+    fwrite(value.data(), 1, value.size(), notify_output);
+    fflush(notify_output);
+  }
+}
+
+static std::map<std::string, BLECharacteristic *> all_characteristics;
+
+BLECharacteristic *BLEService::createCharacteristic(const char *uuid, uint32_t properties) {
+  BLECharacteristic *characteristic = new BLECharacteristic(uuid, properties);
+  characteristics[uuid] = characteristic;
+  all_characteristics[uuid] = characteristic;
+  return characteristic;
+}
+
+bool simWriteCharacteristic(const char *uuid, const std::string &value) {
+  auto it = all_characteristics.find(uuid);
+  if (it == all_characteristics.end()) return false;
+
+  it->second->setValue(value);
+  if (it->second->getCallbacks()) it->second->getCallbacks()->onWrite(it->second);
+  return true;
+}
+
+BLEServer *BLEDevice::createServer() {
+  if (!server) server = new BLEServer();
+  return server;
+}
+
+BLEAdvertising *BLEDevice::getAdvertising() {
+  return &advertising;
+}
+
+void BLEDevice::startAdvertising() {
+  if (!server || !server->getCallbacks()) return;
+
+  // The simulated central connects straight away
+  esp_ble_gatts_cb_param_t param;
+  param.mtu.conn_id = 0;
+  param.mtu.mtu = central_mtu < local_mtu ? central_mtu : local_mtu;
+  server->getCallbacks()->onConnect(server);
+  server->getCallbacks()->onMtuChanged(server, &param);
+}
+
+// NVS. Entries are keyed by namespace and key; the file holds one
+// "namespace key hex-bytes" line per entry.
+
+static std::mutex nvs_mutex;
+static std::map<std::string, std::string> nvs_entries;
+static std::string nvs_path;
+
+static std::string nvsKey(const std::string &space, const char *key) {
+  return space + " " + key;
+}
+
+static void nvsSave() {
+  if (nvs_path.empty()) return;
+  FILE *file = fopen(nvs_path.c_str(), "w");
+  if (!file) return;
+  for (const auto &entry : nvs_entries) {
+    fprintf(file, "%s ", entry.first.c_str());
+    for (unsigned char c : entry.second) fprintf(file, "%02x", c);
+    fprintf(file, "\n");
+  }
+  fclose(file);
+}
+
+void simSetNvsPath(const char *path) {
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  nvs_path = path;
+  nvs_entries.clear();
+
+  FILE *file = fopen(path, "r");
+  if (!file) return;
+  char space[64], key[64], hex[256];
+  while (fscanf(file, "%63s %63s %255s", space, key, hex) == 3) {
+    std::string value;
+    for (size_t i = 0; hex[i] && hex[i + 1]; i += 2) {
+      unsigned int byte;
+      sscanf(hex + i, "%2x", &byte);
+      value.push_back((char)byte);
+    }
+    nvs_entries[nvsKey(space, key)] = value;
+  }
+  fclose(file);
+}
+
+bool Preferences::begin(const char *name, bool readOnly) {
+  space = name;
+  read_only = readOnly;
+  open = true;
+  return true;
+}
+
+void Preferences::end() { open = false; }
+
+bool Preferences::isKey(const char *key) {
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  return open && nvs_entries.count(nvsKey(space, key));
+}
+
+bool Preferences::remove(const char *key) {
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  if (!open || read_only || !nvs_entries.erase(nvsKey(space, key))) return false;
+  nvsSave();
+  return true;
+}
+
+bool Preferences::clear() {
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  if (!open || read_only) return false;
+  for (auto it = nvs_entries.begin(); it != nvs_entries.end(); ) {
+    it = it->first.compare(0, space.size() + 1, space + " ") ? std::next(it) : nvs_entries.erase(it);
+  }
+  nvsSave();
+  return true;
+}
+
+bool Preferences::get(const char *key, void *value, size_t length) {
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  if (!open) return false;
+  auto it = nvs_entries.find(nvsKey(space, key));
+  if (it == nvs_entries.end() || it->second.size() != length) return false;
+  memcpy(value, it->second.data(), length);
+  return true;
+}
+
+size_t Preferences::put(const char *key, const void *value, size_t length) {
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  if (!open || read_only) return 0;
+  nvs_entries[nvsKey(space, key)] = std::string((const char *)value, length);
+  nvsSave();
+  return length;
+}
+
+int32_t Preferences::getInt(const char *key, int32_t defaultValue) {
+  int32_t value = defaultValue;
+  get(key, &value, sizeof(value));
+  return value;
+}
+
+float Preferences::getFloat(const char *key, float defaultValue) {
+  float value = defaultValue;
+  get(key, &value, sizeof(value));
+  return value;
+}
+
+size_t Preferences::putInt(const char *key, int32_t value) { return put(key, &value, sizeof(value)); }
+size_t Preferences::putFloat(const char *key, float value) { return put(key, &value, sizeof(value)); }
@@ -0,0 +1,90 @@
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+// Host-side stand-ins for the parts of the ESP32 Arduino core and FreeRTOS
+// the firmware uses. Tasks run as std::threads, GPIO is an array of levels
+// driven by the synthetic signal generators, and interrupts are dispatched
+// one at a time like on a single interrupt controller.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Timing
+
+int64_t esp_timer_get_time();
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+
+// GPIO and interrupts
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define LOW 0
+#define HIGH 1
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define SIM_GPIO_COUNT 40
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode);
+
+// Drive a pin from a signal generator, running its interrupt on an edge
+void simSetPin(uint8_t pin, int level);
+
+// Levels of GPIO 0-31 as seen by GPIO_IN_REG
+uint32_t simGpioIn();
+
+// FreeRTOS
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef struct SimTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffUL
+#define configMAX_PRIORITIES 25
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portYIELD_FROM_ISR()
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack,
+                                   void *param, UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previous, TickType_t increment);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+
+// Critical sections share one lock with interrupt dispatch
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+void simEnterCritical(portMUX_TYPE *mux);
+void simExitCritical(portMUX_TYPE *mux);
+#define portENTER_CRITICAL(mux) simEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) simExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) simEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) simExitCritical(mux)
+
+#define IRAM_ATTR
+
+// Run the Arduino loop task, as the ESP32 core does after setup()
+void simStartLoopTask();
+
+#endif // SIM_HAL_H
@@ -0,0 +1,191 @@
+// Native build of the firmware. Runs the real setup() and pipeline tasks
+// against simulated hardware and writes BLE notifications to a file, FIFO
+// or stdout, runs microbenchmarks of the per-sample hot path, or runs the
+// driver tests against simulated hardware.
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <Preferences.h>
+#include <Wire.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+#include "acquisition.h"
+#include "caliper.h"
+#include "device_config.h"
+#include "sim_signals.h"
+
+extern void setup();
+int runBenchmarks();
+int runDriverTests();
+
+// Load cell and caliper wiring and control characteristic, as in main.cpp
+static const uint8_t SIM_LOADCELL_DOUT_PIN = 17;
+static const uint8_t SIM_SECOND_LOADCELL_DOUT_PIN = 26;
+static const uint8_t SIM_CALIPER_CLK_PIN = 18;
+static const uint8_t SIM_CALIPER_DATA_PIN = 19;
+static const char *SIM_CONTROL_UUID = "6e400003-b5a3-f393-e0a9-e50e24dcca9e";
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --duration S      run for S seconds (default 10, 0 = forever)\n"
+          "  --out FILE        write notifications to FILE, '-' for stdout\n"
+          "  --mtu N           MTU requested by the simulated central (default 247)\n"
+          "  --nvs FILE        keep NVS in FILE across runs, like a power cycle\n"
+          "  --sps N           HX711 conversion rate (default 80)\n"
+          "  --caliper-hz N    caliper frame rate (default 50)\n"
+          "  --tamp-period S   seconds between tamps (default 3)\n"
+          "  --peak-kg N       peak tamp force (default 15)\n"
+          "  --drift-kg N      load cell zero drift per second (default 0)\n"
+          "  --load-cells N    load cells sharing the force, 1 or 2 (default 1)\n"
+          "  --tilt F          right minus left share of the force (default 0)\n"
+          "  --averaging N     device config: moving average length\n"
+          "  --median N        device config: spike filter median taps\n"
+          "  --filter-order N  device config: moving average stages\n"
+          "  --decimation N    device config: conversions per burst sample\n"
+          "  --period-ms N     device config: min time between samples at rest\n"
+          "  --holdoff-ms N    device config: burst hold-off after a tamp\n"
+          "  --pretrigger N    device config: idle frames sent ahead of a burst\n"
+          "  --auto-zero-g N   device config: auto-zero band, 0 = off\n"
+          "  --batch N         device config: max samples per notification\n"
+          "  --ping-ms N       send a clock sync ping every N ms (default 0, off)\n"
+          "  --bench           run hot path microbenchmarks and exit\n"
+          "  --test            run driver tests and exit\n"
+          "Notifications are written as a little-endian 16-bit length followed\n"
+          "by the payload.\n",
+          argv0);
+}
+
+int main(int argc, char *argv[]) {
+  SimSignalConfig signals;
+  double duration = 10;
+  const char *out_path = NULL;
+  DeviceConfig device_config = defaultConfig(0);
+  bool configure = false;
+  int ping_ms = 0;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+    if (!strcmp(arg, "--bench")) {
+      return runBenchmarks();
+    } else if (!strcmp(arg, "--test")) {
+      return runDriverTests();
+    } else if (!strcmp(arg, "--help") || !value) {
+      usage(argv[0]);
+      return !strcmp(arg, "--help") ? 0 : 1;
+    } else if (!strcmp(arg, "--duration")) {
+      duration = atof(value);
+    } else if (!strcmp(arg, "--out")) {
+      out_path = value;
+    } else if (!strcmp(arg, "--nvs")) {
+      simSetNvsPath(value);
+    } else if (!strcmp(arg, "--mtu")) {
+      simSetCentralMtu(atoi(value));
+    } else if (!strcmp(arg, "--sps")) {
+      signals.hx711_sps = atof(value);
+    } else if (!strcmp(arg, "--caliper-hz")) {
+      signals.caliper_hz = atof(value);
+    } else if (!strcmp(arg, "--tamp-period")) {
+      signals.tamp_period_s = atof(value);
+    } else if (!strcmp(arg, "--peak-kg")) {
+      signals.peak_kg = atof(value);
+    } else if (!strcmp(arg, "--drift-kg")) {
+      signals.drift_kg_per_s = atof(value);
+    } else if (!strcmp(arg, "--load-cells")) {
+      signals.load_cells = atoi(value);
+    } else if (!strcmp(arg, "--tilt")) {
+      signals.tilt = atof(value);
+    } else if (!strcmp(arg, "--averaging")) {
+      device_config.averaging = atoi(value);
+      configure = true;
+    } else if (!strcmp(arg, "--median")) {
+      device_config.median_taps = atoi(value);
+      configure = true;
+    } else if (!strcmp(arg, "--filter-order")) {
+      device_config.filter_order = atoi(value);
+      configure = true;
+    } else if (!strcmp(arg, "--decimation")) {
+      device_config.decimation = atoi(value);
+      configure = true;
+    } else if (!strcmp(arg, "--period-ms")) {
+      device_config.sample_period_us = atof(value) * 1000;
+      configure = true;
+    } else if (!strcmp(arg, "--holdoff-ms")) {
+      device_config.holdoff_ms = atoi(value);
+      configure = true;
+    } else if (!strcmp(arg, "--pretrigger")) {
+      device_config.pretrigger_frames = atoi(value);
+      configure = true;
+    } else if (!strcmp(arg, "--auto-zero-g")) {
+      device_config.auto_zero_g = atoi(value);
+      configure = true;
+    } else if (!strcmp(arg, "--batch")) {
+      device_config.batch_samples = atoi(value);
+      configure = true;
+    } else if (!strcmp(arg, "--ping-ms")) {
+      ping_ms = atoi(value);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+    i++;
+  }
+
+  if (out_path) {
+    FILE *out = strcmp(out_path, "-") ? fopen(out_path, "wb") : stdout;
+    if (!out) {
+      perror(out_path);
+      return 1;
+    }
+    simSetNotifyOutput(out);
+  }
+
+  simConfigureSignals(signals);
+  simStartLoadCells(SIM_LOADCELL_DOUT_PIN, SIM_SECOND_LOADCELL_DOUT_PIN);
+  setup();
+
+  // Configure the device the way the client would
+  if (configure) {
+    std::string command(1, (char)CONTROL_SET_CONFIG);
+    command.append((const char *)&device_config, sizeof(device_config));
+    simWriteCharacteristic(SIM_CONTROL_UUID, command);
+  }
+
+  simStartCaliper(SIM_CALIPER_CLK_PIN, SIM_CALIPER_DATA_PIN);
+  simStartLoopTask();
+
+  // Ping the way the client would, echoing a counter as the token
+  auto start = std::chrono::steady_clock::now();
+  uint32_t ping_token = 0;
+  for (;;) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ping_ms > 0 ? ping_ms : 1000));
+    if (ping_ms > 0) {
+      std::string command(1, (char)CONTROL_PING);
+      command.append((const char *)&ping_token, sizeof(ping_token));
+      simWriteCharacteristic(SIM_CONTROL_UUID, command);
+      ping_token++;
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (duration > 0 && elapsed >= duration) break;
+  }
+
+  fprintf(stderr, "notifications: %llu (%llu bytes)\n",
+          (unsigned long long)simNotifyCount(), (unsigned long long)simNotifyBytes());
+  fprintf(stderr, "first notification: %.1f ms after boot\n", simFirstNotifyUs() / 1000.);
+  fprintf(stderr, "i2c: %llu bytes in %llu transactions\n",
+          (unsigned long long)Wire.bytes, (unsigned long long)Wire.transactions);
+  fprintf(stderr, "overruns: force %u, caliper %u\n",
+          (unsigned)force_overruns, (unsigned)caliper_overruns);
+
+  // Pipeline tasks never return, so skip static destructors
+  fflush(NULL);
+  _exit(0);
+}
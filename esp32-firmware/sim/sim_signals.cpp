@@ -0,0 +1,173 @@
+#include "sim_signals.h"
+
+#include <Arduino.h>
+#include <driver/spi_master.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+static SimSignalConfig config;
+
+// An HX711 on its own SPI bus. Channel and gain are set by the clocks after
+// the 24 data bits of a read, and apply to the conversion after it.
+struct SimHx711 {
+  uint8_t dout = 0;
+  std::mutex mutex;
+  long counts = 0;
+  int gain_pulses = 1; // power-on default: channel A, gain 128
+  int pulses = 0;
+
+  void convert(long channel_a, long channel_b) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      long value;
+      switch (gain_pulses) {
+      case 2: value = channel_b / 4; break; // B, gain 32
+      case 3: value = channel_a / 2; break; // A, gain 64
+      default: value = channel_a; break;    // A, gain 128
+      }
+      counts = std::min(std::max(value, -0x800000L), 0x7fffffL);
+    }
+
+    // An unread conversion keeps DOUT low, so there is no new edge
+    simSetPin(dout, LOW);
+  }
+
+  // A read: each rising clock edge shifts the next bit out on DOUT, most
+  // significant first, and the 25th pulls DOUT back high
+  void transfer(uint8_t *rx, size_t bits) {
+    uint32_t word;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      word = (uint32_t)counts & 0xffffff;
+      if (bits > 24 && bits <= 27) gain_pulses = bits - 24;
+      pulses = bits;
+    }
+
+    memset(rx, 0, (bits + 7) / 8);
+    for (size_t bit = 0; bit < bits; bit++) {
+      int level = bit < 24 ? (word >> (23 - bit)) & 1 : HIGH;
+      simSetPin(dout, level);
+      if (level) rx[bit / 8] |= 0x80 >> (bit % 8);
+    }
+    simSetPin(dout, HIGH);
+  }
+};
+
+// Buses the firmware reads the HX711s on, as in main.cpp
+static const spi_host_device_t SIM_LOADCELL_SPI_HOSTS[SIM_LOADCELL_HX711S] = {SPI2_HOST, SPI3_HOST};
+static SimHx711 hx711s[SIM_LOADCELL_HX711S];
+
+template <int N>
+static void loadCellTransfer(const uint8_t *tx, uint8_t *rx, size_t bits) {
+  hx711s[N].transfer(rx, bits);
+}
+
+static const SimSpiTransfer LOADCELL_TRANSFERS[SIM_LOADCELL_HX711S] = {loadCellTransfer<0>,
+                                                                       loadCellTransfer<1>};
+
+void simConfigureSignals(const SimSignalConfig &c) {
+  config = c;
+}
+
+double simForceKg(double t) {
+  const double ramp = 0.3, hold = 0.2, release = 0.2;
+  double phase = fmod(t, config.tamp_period_s) - (config.tamp_period_s - ramp - hold - release);
+
+  if (phase < 0) return 0;
+  if (phase < ramp) return config.peak_kg * phase / ramp;
+  phase -= ramp;
+  if (phase < hold) return config.peak_kg;
+  phase -= hold;
+  if (phase < release) return config.peak_kg * (1 - phase / release);
+  return 0;
+}
+
+double simPositionMm(double t) {
+  return 20.0 - 8.0 * simForceKg(t) / config.peak_kg;
+}
+
+uint32_t simCaliperWord(double mm) {
+  uint32_t hundredths = (uint32_t)lround(fabs(mm) * 100) & 0xfffff;
+  return hundredths | (mm < 0 ? 1UL << 20 : 0);
+}
+
+static double seconds() {
+  return esp_timer_get_time() / 1000000.;
+}
+
+void simConvertLoadCell(int index, long channel_a, long channel_b) {
+  hx711s[index].convert(channel_a, channel_b);
+}
+
+int simLoadCellPulses(int index) {
+  std::lock_guard<std::mutex> lock(hx711s[index].mutex);
+  return hx711s[index].pulses;
+}
+
+static void loadCellThread() {
+  std::mt19937 rng(1);
+  std::normal_distribution<double> noise(0, config.noise_kg);
+  auto period = std::chrono::microseconds((long)(1000000 / config.hx711_sps));
+  auto next = std::chrono::steady_clock::now();
+
+  for (;;) {
+    next += period;
+    std::this_thread::sleep_until(next);
+
+    double t = seconds();
+    double kg = simForceKg(t) + config.drift_kg_per_s * t;
+    if (config.load_cells < 2) {
+      simConvertLoadCell(0, config.zero_counts + lround((kg + noise(rng)) * config.counts_per_kg), 0);
+      continue;
+    }
+
+    // The right cell is on channel B of the first HX711 and on the second
+    // one, so either wiring sees it
+    double left_kg = kg * (1 - config.tilt) / 2 + noise(rng);
+    double right_kg = kg * (1 + config.tilt) / 2 + noise(rng);
+    long left = config.zero_counts + lround(left_kg * config.counts_per_kg);
+    long right = config.zero_counts_right + lround(right_kg * config.counts_per_kg);
+    simConvertLoadCell(0, left, right);
+    simConvertLoadCell(1, right, 0);
+  }
+}
+
+void simAttachLoadCell(int index, uint8_t dout_pin) {
+  hx711s[index].dout = dout_pin;
+  simSetPin(dout_pin, HIGH);
+  simAttachSpiDevice(SIM_LOADCELL_SPI_HOSTS[index], LOADCELL_TRANSFERS[index]);
+}
+
+void simStartLoadCells(uint8_t dout_pin, uint8_t second_dout_pin) {
+  simAttachLoadCell(0, dout_pin);
+  simAttachLoadCell(1, second_dout_pin);
+  std::thread(loadCellThread).detach();
+}
+
+static void caliperThread(uint8_t clk_pin, uint8_t data_pin) {
+  auto period = std::chrono::microseconds((long)(1000000 / config.caliper_hz));
+  auto next = std::chrono::steady_clock::now();
+
+  simSetPin(clk_pin, HIGH);
+  for (;;) {
+    next += period;
+    std::this_thread::sleep_until(next);
+
+    uint32_t word = simCaliperWord(simPositionMm(seconds()));
+    for (int bit = 0; bit < 24; bit++) {
+      // The level shifter inverts the data line
+      simSetPin(data_pin, (word >> bit) & 1 ? LOW : HIGH);
+      simSetPin(clk_pin, LOW);
+      simSetPin(clk_pin, HIGH);
+    }
+  }
+}
+
+void simStartCaliper(uint8_t clk_pin, uint8_t data_pin) {
+  std::thread(caliperThread, clk_pin, data_pin).detach();
+}
@@ -0,0 +1,49 @@
+#ifndef SIM_SIGNALS_H
+#define SIM_SIGNALS_H
+
+#include <stdint.h>
+
+// Synthetic load cell and caliper. Every tamp_period_s the force ramps up to
+// peak_kg, holds and releases, while the caliper position drops with force.
+struct SimSignalConfig {
+  double hx711_sps = 80;       // HX711 conversion rate (10 or 80)
+  double caliper_hz = 50;      // caliper frame rate
+  double tamp_period_s = 3;    // time between tamps
+  double peak_kg = 15;         // peak tamp force
+  double noise_kg = 0.005;     // load cell noise (standard deviation)
+  double counts_per_kg = 57300 / 0.546;
+  long zero_counts = 84000;    // raw reading with no load
+  long zero_counts_right = -31000; // same for the right load cell, if there are two
+  int load_cells = 1;          // load cells sharing the force
+  double tilt = 0;             // share of the force on the right minus the left
+  double drift_kg_per_s = 0;   // zero drift, as from a warming load cell
+};
+
+void simConfigureSignals(const SimSignalConfig &config);
+
+// Force (kg) and position (mm) of the model at a time since start
+double simForceKg(double t);
+double simPositionMm(double t);
+
+// Load cells: HX711s on SPI buses, with DOUT falling at the HX711 rate
+// until the conversion is read. With two load cells the left one is on
+// channel A of the first HX711 and the right one on both its channel B and
+// the second HX711, so either wiring of the firmware can read it.
+#define SIM_LOADCELL_HX711S 2
+void simStartLoadCells(uint8_t dout_pin, uint8_t second_dout_pin);
+
+// One HX711 alone, converting only when simConvertLoadCell() is called.
+// Inputs are in counts at gain 128.
+void simAttachLoadCell(int index, uint8_t dout_pin);
+void simConvertLoadCell(int index, long channel_a, long channel_b);
+
+// Clock pulses in the last read, 25-27 depending on the gain it selected
+int simLoadCellPulses(int index);
+
+// Caliper: 24-bit frames clocked out on the clock and data pins
+void simStartCaliper(uint8_t clk_pin, uint8_t data_pin);
+
+// Encode a position the way the caliper does (hundredths of a mm, bit 20 sign)
+uint32_t simCaliperWord(double mm);
+
+#endif // SIM_SIGNALS_H
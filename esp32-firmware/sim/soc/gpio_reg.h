@@ -0,0 +1,10 @@
+#ifndef SOC_GPIO_REG_H
+#define SOC_GPIO_REG_H
+
+#include "sim_hal.h"
+
+// Only the input register is modelled
+#define GPIO_IN_REG 0
+#define REG_READ(reg) simGpioIn()
+
+#endif // SOC_GPIO_REG_H
@@ -0,0 +1,149 @@
+#include <Arduino.h>
+
+#include "acquisition.h"
+#include "profiler.h"
+
+// Only the HX711 readout and ring push run on this stack
+#define ACQUISITION_TASK_STACK 2048
+
+// The HX711 takes four conversions to settle after a channel or gain
+// change, so the first three after switching are dropped
+#define SETTLE_DISCARD 3
+
+SpscRing<ForceReading, FORCE_RING_SIZE> force_ring;
+volatile uint32_t force_overruns = 0;
+
+// An HX711 and the channels read from it, in turn
+struct Converter {
+  Hx711Spi *adc;
+  int drdy_pin;
+  uint8_t channels[MAX_LOADCELL_CHANNELS]; // indexes into load_cells
+  uint8_t count;
+  uint8_t active;   // position in channels of the conversion in progress
+  uint8_t settling; // conversions still to drop after a switch
+
+  // Set from the data-ready edge until the conversion has been shifted out
+  volatile bool busy;
+  volatile uint64_t ready_us;
+};
+
+static LoadCellChannel load_cells[MAX_LOADCELL_CHANNELS];
+static Converter converters[MAX_LOADCELL_CHANNELS];
+static int converter_count = 0;
+
+static TaskHandle_t acquisition_task = NULL;
+static TaskHandle_t consumer_task = NULL;
+static portMUX_TYPE drdy_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// HX711 DOUT falling edge. DOUT also toggles while the data bits are being
+// clocked out, so edges are ignored while a read is in progress or if the
+// line is already back high.
+static void IRAM_ATTR onDataReady(void *arg) {
+  Converter *converter = (Converter *)arg;
+  uint64_t now = esp_timer_get_time();
+  BaseType_t woken = pdFALSE;
+
+  portENTER_CRITICAL_ISR(&drdy_mux);
+  bool ready = !converter->busy && !digitalRead(converter->drdy_pin);
+  if (ready) {
+    converter->busy = true;
+    converter->ready_us = now;
+  }
+  portEXIT_CRITICAL_ISR(&drdy_mux);
+
+  if (ready) {
+    vTaskNotifyGiveFromISR(acquisition_task, &woken);
+    if (woken) {
+      portYIELD_FROM_ISR();
+    }
+  }
+}
+
+// Shift out the conversion that is ready, selecting the channel for the
+// next one with the same read
+static void readConverter(Converter &converter) {
+  const LoadCellChannel &current = load_cells[converter.channels[converter.active]];
+  bool keep = converter.settling == 0;
+  uint8_t next = keep ? (converter.active + 1) % converter.count : converter.active;
+  converter.adc->setGain(load_cells[converter.channels[next]].gain);
+
+  // DOUT is already low, so the conversion can be clocked out at once
+  ForceReading reading;
+  reading.timestamp_us = converter.ready_us;
+  reading.channel = converter.channels[converter.active];
+  uint32_t start = cycleCount();
+  reading.counts = hx711Normalize(converter.adc->read(), current.gain);
+  profileStage(STAGE_HX711_READ, start);
+
+  if (next != converter.active) {
+    converter.active = next;
+    converter.settling = SETTLE_DISCARD;
+  } else if (!keep) {
+    converter.settling--;
+  }
+  if (!keep) return;
+
+  if (force_ring.push(reading)) {
+    xTaskNotifyGive(consumer_task);
+  } else {
+    force_overruns++;
+  }
+}
+
+static void acquisitionTask(void *param) {
+  for (int i = 0; i < converter_count; i++) {
+    attachInterruptArg(digitalPinToInterrupt(converters[i].drdy_pin), onDataReady, &converters[i],
+                       FALLING);
+  }
+
+  bool pending = false;
+  for (;;) {
+    if (!pending) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+
+    pending = false;
+    for (int i = 0; i < converter_count; i++) {
+      Converter &converter = converters[i];
+      if (!converter.busy) continue;
+      readConverter(converter);
+
+      // Pick up a conversion that completed while edges were being ignored
+      portENTER_CRITICAL(&drdy_mux);
+      bool again = !digitalRead(converter.drdy_pin);
+      converter.busy = again;
+      if (again) converter.ready_us = esp_timer_get_time();
+      portEXIT_CRITICAL(&drdy_mux);
+      pending |= again;
+    }
+  }
+}
+
+void startAcquisition(const LoadCellChannel *channels, int count, BaseType_t core,
+                      TaskHandle_t consumer) {
+  consumer_task = consumer;
+
+  // Group the channels by HX711
+  for (int i = 0; i < count && i < MAX_LOADCELL_CHANNELS; i++) {
+    load_cells[i] = channels[i];
+
+    int c = 0;
+    while (c < converter_count && converters[c].adc != channels[i].adc) c++;
+    Converter &converter = converters[c];
+    if (c == converter_count) {
+      converter_count++;
+      converter.adc = channels[i].adc;
+      converter.drdy_pin = channels[i].dout_pin;
+      converter.count = 0;
+      converter.active = 0;
+      converter.settling = 0;
+      converter.busy = false;
+      converter.ready_us = 0;
+    }
+    converter.channels[converter.count++] = i;
+  }
+
+  // Highest priority on its core so nothing delays shifting out a conversion
+  xTaskCreatePinnedToCore(acquisitionTask, "acquisition", ACQUISITION_TASK_STACK, NULL,
+                          configMAX_PRIORITIES - 1, &acquisition_task, core);
+}
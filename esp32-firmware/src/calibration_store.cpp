@@ -0,0 +1,52 @@
+#include <Preferences.h>
+
+#include "calibration_store.h"
+
+#define NVS_NAMESPACE "tamper"
+#define KEY_COUNTS_PER_KG "counts_per_kg"
+#define KEY_ZERO_OFFSET "zero_offset"
+#define KEY_BALANCE_OFFSET "balance_offset"
+
+float loadCountsPerKg(float fallback) {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, true)) return fallback;
+  float counts_per_kg = prefs.getFloat(KEY_COUNTS_PER_KG, fallback);
+  prefs.end();
+
+  if (!(counts_per_kg > 0)) return fallback;
+  return counts_per_kg;
+}
+
+static bool loadOffset(const char *key, int32_t &offset) {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, true)) return false;
+  bool found = prefs.isKey(key);
+  if (found) offset = prefs.getInt(key, 0);
+  prefs.end();
+  return found;
+}
+
+bool loadZeroOffset(int32_t &offset) {
+  return loadOffset(KEY_ZERO_OFFSET, offset);
+}
+
+bool loadBalanceOffset(int32_t &offset) {
+  return loadOffset(KEY_BALANCE_OFFSET, offset);
+}
+
+void saveCalibration(float counts_per_kg, int32_t offset, int32_t balance_offset) {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, false)) return;
+
+  // Skip writes that would not change anything, to spare the flash
+  if (prefs.getFloat(KEY_COUNTS_PER_KG, 0) != counts_per_kg) {
+    prefs.putFloat(KEY_COUNTS_PER_KG, counts_per_kg);
+  }
+  if (!prefs.isKey(KEY_ZERO_OFFSET) || prefs.getInt(KEY_ZERO_OFFSET, 0) != offset) {
+    prefs.putInt(KEY_ZERO_OFFSET, offset);
+  }
+  if (!prefs.isKey(KEY_BALANCE_OFFSET) || prefs.getInt(KEY_BALANCE_OFFSET, 0) != balance_offset) {
+    prefs.putInt(KEY_BALANCE_OFFSET, balance_offset);
+  }
+  prefs.end();
+}
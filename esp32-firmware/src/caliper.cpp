@@ -0,0 +1,36 @@
+#include <Arduino.h>
+#include <soc/gpio_reg.h>
+
+#include "caliper.h"
+
+SpscRing<CaliperEdge, CALIPER_RING_SIZE> caliper_edges;
+volatile uint32_t caliper_overruns = 0;
+
+static uint32_t clk_mask = 0;
+static uint32_t data_mask = 0;
+static bool edges_lost = false;
+
+// Falling clock edge. Both lines are sampled with a single register read and
+// the edge is queued; all decoding happens outside interrupt context.
+static void IRAM_ATTR onCaliperClock() {
+  uint32_t levels = REG_READ(GPIO_IN_REG);
+  if (levels & clk_mask) return; // glitch, clock already back high
+
+  CaliperEdge edge;
+  edge.time_us = esp_timer_get_time();
+  edge.data = (levels & data_mask) ? 1 : 0;
+  edge.lost = edges_lost;
+  edges_lost = !caliper_edges.push(edge);
+  if (edges_lost) {
+    caliper_overruns++;
+  }
+}
+
+void startCaliper(int clk_pin, int data_pin) {
+  clk_mask = 1UL << clk_pin;
+  data_mask = 1UL << data_pin;
+
+  pinMode(clk_pin, INPUT);
+  pinMode(data_pin, INPUT);
+  attachInterrupt(digitalPinToInterrupt(clk_pin), onCaliperClock, FALLING);
+}
@@ -0,0 +1,37 @@
+#include "hx711_spi.h"
+
+// PD_SCK must stay under 60 us high or the HX711 powers down, which a
+// hardware clock never comes close to
+#define HX711_CLOCK_HZ 1000000
+
+bool Hx711Spi::begin(int dout_pin, int sck_pin, Hx711Gain g, spi_host_device_t host) {
+  gain = g;
+
+  spi_bus_config_t bus = {};
+  bus.mosi_io_num = -1;
+  bus.miso_io_num = dout_pin;
+  bus.sclk_io_num = sck_pin;
+  bus.quadwp_io_num = -1;
+  bus.quadhd_io_num = -1;
+  bus.max_transfer_sz = 4;
+  if (spi_bus_initialize(host, &bus, SPI_DMA_DISABLED) != ESP_OK) return false;
+
+  // Mode 1: the clock idles low, which keeps the HX711 powered up, and DOUT
+  // is sampled on the falling edge after the HX711 shifts it on the rising one
+  spi_device_interface_config_t config = {};
+  config.mode = 1;
+  config.clock_speed_hz = HX711_CLOCK_HZ;
+  config.spics_io_num = -1;
+  config.queue_size = 1;
+  return spi_bus_add_device(host, &config, &device) == ESP_OK;
+}
+
+int32_t Hx711Spi::read() {
+  // 24 data bits, then gain pulses that select the next conversion. Bits
+  // clocked in during the gain pulses are ignored.
+  spi_transaction_t transaction = {};
+  transaction.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+  transaction.length = 24 + gain;
+  if (spi_device_polling_transmit(device, &transaction) != ESP_OK) return 0;
+  return hx711Decode(transaction.rx_data);
+}
@@ -1,30 +1,83 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
-#include <HX711.h>
 #include <BLEDevice.h>
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
 #include <Wire.h>
 
+#include "acquisition.h"
+#include "calibration_store.h"
+#include "caliper.h"
+#include "device_config.h"
+#include "display_diff.h"
+#include "force_filter.h"
+#include "hx711_spi.h"
+#include "profiler.h"
+#include "protocol.h"
+#include "sample_batcher.h"
+#include "tamp_detector.h"
+#include "zero_tracker.h"
+
 // HX711 circuit wiring
 const int LOADCELL_DOUT_PIN = 17;
 const int LOADCELL_SCK_PIN = 16;
+const Hx711Gain LOADCELL_GAIN = HX711_GAIN_A128;
+
+// Optional second load cell, to the right of the first, for spotting tilted
+// tamps. It can be on channel B of the same HX711, read in turn with channel
+// A, or on a second HX711 read at the full rate. Each switch between A and B
+// costs three settling conversions, so each channel keeps one conversion in
+// eight: 10 SPS per channel at 80 SPS. Set LOADCELL_LAYOUT in build_flags.
+#define LOADCELL_SINGLE 0
+#define LOADCELL_CHANNEL_B 1
+#define LOADCELL_SECOND_HX711 2
+#ifndef LOADCELL_LAYOUT
+#define LOADCELL_LAYOUT LOADCELL_SINGLE
+#endif
+
+const int SECOND_LOADCELL_DOUT_PIN = 26;
+const int SECOND_LOADCELL_SCK_PIN = 27;
 
 // Caliper wiring
 const int CALIPER_CLK_PIN = 18;
 const int CALIPER_DATA_PIN = 19;
 
-HX711 scale;
-
-// Variables to accumulate the bits
-volatile uint32_t word1_temp = 0;
-volatile uint8_t bit_count = 0;
-volatile unsigned long last_bit_time = 0;
-
-// Variables to store the full words for processing
-volatile uint32_t word1 = 0;
-volatile bool data_ready = false;
+Hx711Spi hx711;
+#if LOADCELL_LAYOUT == LOADCELL_SECOND_HX711
+Hx711Spi second_hx711;
+#endif
+
+// Left load cell first
+const LoadCellChannel LOADCELL_CHANNELS[] = {
+  {&hx711, LOADCELL_DOUT_PIN, LOADCELL_GAIN},
+#if LOADCELL_LAYOUT == LOADCELL_CHANNEL_B
+  {&hx711, LOADCELL_DOUT_PIN, HX711_GAIN_B32},
+#elif LOADCELL_LAYOUT == LOADCELL_SECOND_HX711
+  {&second_hx711, SECOND_LOADCELL_DOUT_PIN, LOADCELL_GAIN},
+#endif
+};
+const int LOADCELL_COUNT = sizeof(LOADCELL_CHANNELS) / sizeof(LOADCELL_CHANNELS[0]);
+
+// Latest conversion of each load cell. Once every load cell has a new one
+// the force is their sum and the balance right minus left.
+int32_t loadcell_counts[MAX_LOADCELL_CHANNELS];
+uint8_t loadcells_seen = 0;
+
+// Assembles caliper words from captured clock edges
+CaliperDecoder caliper_decoder;
+
+// Last received caliper word and the time of its first clock edge
+uint32_t caliper_word = 0;
+uint64_t caliper_us = 0;
+uint8_t frame_flags = 0;
+uint16_t frame_sequence = 0;
+uint32_t reported_overruns = 0;
+
+// Flags carried by the next streamed and the next displayed frame, so they
+// survive idle suppression
+uint8_t pending_flags = 0;
+uint8_t display_flags = 0;
 
 // Current caliper value
 float scale_val = 0;
@@ -32,12 +85,101 @@ float scale_val_max = -1000;
 float caliper_val = 0;
 float caliper_val_max = -1000;
 
+// Load cell calibration used until one is stored in NVS
 const float CALIPER_FACTOR = 57300 / 0.546;
-
-hw_timer_t *my_timer = NULL;
-volatile bool read_value = false;
-const uint64_t step_us = 100000;
-uint64_t cur_us = 0;
+float counts_per_kg = CALIPER_FACTOR;
+
+// A stored zero offset is refined at boot, unless the average moves it by
+// more than this: the scale was most likely loaded at power on
+const float REFINE_MAX_KG = 0.2;
+
+// On-device tamp detection. Thresholds, heartbeat and hold-off come from the
+// runtime configuration, which the client sets to its own trigger levels.
+// At rest only a heartbeat is streamed and the display is decimated to the
+// configured sample period; a burst samples every conversion and its lead-in
+// comes from the pre-trigger history, which is kept at the full rate and
+// whose depth is configured too.
+TampDetector<MAX_PRETRIGGER_FRAMES> detector;
+
+// FreeRTOS task layout. Acquisition and sample assembly run on the APP core;
+// transport and display share the PRO core with the BLE stack, so a slow
+// I2C flush or BLE stall never delays sampling.
+const BaseType_t SAMPLING_CORE = 1;
+const BaseType_t IO_CORE = 0;
+
+const uint32_t SAMPLE_TASK_STACK = 3072;
+const uint32_t TRANSPORT_TASK_STACK = 4096;
+const uint32_t DISPLAY_TASK_STACK = 4096;
+
+const UBaseType_t SAMPLE_TASK_PRIORITY = 4;    // below acquisition
+const UBaseType_t TRANSPORT_TASK_PRIORITY = 3;
+const UBaseType_t DISPLAY_TASK_PRIORITY = 1;
+
+TaskHandle_t sample_task = NULL;
+TaskHandle_t transport_task = NULL;
+
+// Frames handed from the sample task to the transport and display tasks
+#define FRAME_RING_SIZE 256
+SpscRing<SampleFrame, FRAME_RING_SIZE> transport_ring;
+SpscRing<SampleFrame, FRAME_RING_SIZE> display_ring;
+
+// Runtime configuration, written by the client over the control
+// characteristic. Each task picks up a new generation when it next runs.
+DeviceConfig config;
+volatile uint32_t config_generation = 0;
+portMUX_TYPE config_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Spike filter, smoothing and decimation of HX711 conversions, set up from
+// the runtime configuration
+ForceFilter force_filter;
+ForceFilter balance_filter;
+uint64_t last_sample_us = 0;
+
+// Tare and auto-zero, run alongside sampling rather than blocking it. A new
+// tare offset is handed to the display task to be saved, as flash writes
+// stall the CPU.
+ZeroTracker zero_tracker;
+ZeroTracker balance_tracker;
+volatile int32_t offset_to_save = 0;
+volatile int32_t balance_to_save = 0;
+volatile bool save_offset = false;
+
+// Notification batching. A new client gets a fresh stream starting with a
+// keyframe.
+SampleBatcher batcher;
+volatile uint16_t negotiated_mtu = ATT_DEFAULT_MTU;
+volatile bool stream_restart = false;
+
+// Recently streamed frames, indexed by sequence number, so frames the client
+// missed can be sent again on request
+#define HISTORY_SIZE 512 // 6.4 s at 80 SPS, divides 65536
+SampleFrame history[HISTORY_SIZE];
+uint16_t history_next = 0; // sequence after the newest frame in history
+SampleBatcher resend_batcher(PACKET_VERSION_RETRANSMIT);
+
+struct RetransmitRequest {
+  uint16_t first;
+  uint16_t count;
+};
+
+SpscRing<RetransmitRequest, 8> retransmit_requests;
+
+// Set SERIAL_SAMPLES in build_flags to also print every streamed sample on
+// the serial port as a "time,force,displacement,balance" row, for clients
+// reading USB serial instead of BLE. A row is about 30 bytes, so 115200
+// baud keeps up with a full-rate burst.
+#ifndef SERIAL_SAMPLES
+#define SERIAL_SAMPLES 0
+#endif
+
+// Clock sync pings, answered by the transport task so the pong does not
+// interleave with a batch on the data characteristic
+struct PingRequest {
+  uint32_t token;
+  uint32_t receive_us;
+};
+
+SpscRing<PingRequest, 8> ping_requests;
 
 #define SCREEN_WIDTH 128 // OLED display width, in pixels
 #define SCREEN_HEIGHT 64 // OLED display height, in pixels
@@ -45,7 +187,12 @@ uint64_t cur_us = 0;
 // Declaration for an SSD1306 display connected to I2C (SDA, SCL pins)
 #define OLED_RESET -1 // Reset pin # (or -1 if sharing Arduino reset pin)
 #define SCREEN_ADDRESS 0x3C ///< See datasheet for Address; 0x3D for 128x64, 0x3C for 128x32
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+// Keep the bus at 400 kHz between transfers, partial refreshes write it directly
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, 400000UL, 400000UL);
+
+// Only pages/columns that changed since the last refresh are sent
+#define OLED_CHUNK 32 // data bytes per I2C transaction
+DisplayDiff<SCREEN_WIDTH, SCREEN_HEIGHT> display_diff;
 
 // LED wiring
 const int LED_GRN_PIN = 23;
@@ -59,40 +206,96 @@ volatile bool tare_needed = false;
 BLEServer *pServer = NULL;
 BLEService *pService = NULL;
 BLECharacteristic *pCharacteristic = NULL;
+BLECharacteristic *pControlCharacteristic = NULL;
+BLECharacteristic *pDebugCharacteristic = NULL;
 
-// UUIDs for BLE service and characteristic
+// UUIDs for BLE service and characteristics
 #define SERVICE_UUID "6e400001-b5a3-f393-e0a9-e50e24dcca9e"
 #define CHARACTERISTIC_UUID "6e400002-b5a3-f393-e0a9-e50e24dcca9e"
-
-void IRAM_ATTR onTimer() {
-  cur_us += step_us;
-  read_value = true;
+#define CONTROL_CHARACTERISTIC_UUID "6e400003-b5a3-f393-e0a9-e50e24dcca9e"
+#define DEBUG_CHARACTERISTIC_UUID "6e400004-b5a3-f393-e0a9-e50e24dcca9e"
+
+// Stage timings are printed on Serial and left in the debug characteristic
+// at this interval, then start over, so each report covers one interval
+#define PROFILE_REPORT_MS 10000
+#define PROFILE_REPORT_SIZE 512 // largest attribute value
+
+// Copy the configuration if it changed since the generation last seen
+bool updateConfig(DeviceConfig &local, uint32_t &seen) {
+  if (seen == config_generation) return false;
+
+  portENTER_CRITICAL(&config_mux);
+  local = config;
+  seen = config_generation;
+  portEXIT_CRITICAL(&config_mux);
+  return true;
 }
 
-// Interrupt service routine to read CALIPER_DATA_PIN
-void IRAM_ATTR readCaliperData() {
-  unsigned long current_time = millis();
-  if (digitalRead(CALIPER_CLK_PIN)) return;
-  if (current_time - last_bit_time > 10) {
-    word1_temp = 0;
-    bit_count = 0;
+// Track the ATT MTU so batches fill each notification, and restart the
+// compressed stream for each new client
+class ServerCallbacks : public BLEServerCallbacks {
+  void onConnect(BLEServer *server) {
+    stream_restart = true;
   }
-  last_bit_time = current_time;
-  uint8_t bit = digitalRead(CALIPER_DATA_PIN) ? 0 : 1;
-  word1_temp |= (bit << bit_count);
-  bit_count++;
-  if (bit_count >= 24) {
-    word1 = word1_temp;
-    word1_temp = 0;
-    bit_count = 0;
-    data_ready = true;
+
+  void onDisconnect(BLEServer *server) {
+    negotiated_mtu = ATT_DEFAULT_MTU;
   }
-}
+
+  void onMtuChanged(BLEServer *server, esp_ble_gatts_cb_param_t *param) {
+    negotiated_mtu = param->mtu.mtu;
+  }
+};
+
+// Apply commands written to the control characteristic
+class ControlCallbacks : public BLECharacteristicCallbacks {
+  void onWrite(BLECharacteristic *characteristic) {
+    uint32_t receive_us = (uint32_t)esp_timer_get_time();
+    std::string value = characteristic->getValue();
+    if (value.empty()) return;
+
+    const uint8_t *data = (const uint8_t *)value.data();
+    DeviceConfig active;
+
+    // Resending is left to the transport task
+    if (data[0] == CONTROL_RETRANSMIT && value.size() == 5) {
+      RetransmitRequest request;
+      request.first = data[1] | (data[2] << 8);
+      request.count = data[3] | (data[4] << 8);
+      if (retransmit_requests.push(request)) xTaskNotifyGive(transport_task);
+    }
+
+    // So is answering pings
+    if (data[0] == CONTROL_PING && value.size() == 5) {
+      PingRequest request;
+      request.token = data[1] | (data[2] << 8) | (data[3] << 16) | ((uint32_t)data[4] << 24);
+      request.receive_us = receive_us;
+      if (ping_requests.push(request)) xTaskNotifyGive(transport_task);
+    }
+
+    portENTER_CRITICAL(&config_mux);
+    if (data[0] == CONTROL_SET_CONFIG && value.size() == 1 + sizeof(DeviceConfig)) {
+      DeviceConfig requested;
+      memcpy(&requested, data + 1, sizeof(requested));
+      config = sanitizeConfig(requested, config);
+      config_generation++;
+    }
+    active = config;
+    portEXIT_CRITICAL(&config_mux);
+
+    // Reads always return the active configuration
+    characteristic->setValue((uint8_t *)&active, sizeof(active));
+  }
+};
 
 void IRAM_ATTR tareScale() {
   tare_needed = true;
 }
 
+void sampleTask(void *param);
+void transportTask(void *param);
+void displayTask(void *param);
+
 void setup() {
   Serial.begin(115200);
 
@@ -102,14 +305,38 @@ void setup() {
   pinMode(LED_GRN_PIN, OUTPUT);
   pinMode(LED_RED_PIN, OUTPUT);
 
-  scale.begin(LOADCELL_DOUT_PIN, LOADCELL_SCK_PIN);
-  scale.set_scale(CALIPER_FACTOR);
-  scale.tare();
+  // Start from the stored calibration and offset, so samples are valid
+  // from the first conversion. Without a stored offset, tare in the
+  // background once sampling starts.
+  counts_per_kg = loadCountsPerKg(CALIPER_FACTOR);
+  int32_t stored_offset;
+  if (loadZeroOffset(stored_offset)) {
+    zero_tracker.setOffset(stored_offset);
+    zero_tracker.startRefine(REFINE_MAX_KG * counts_per_kg);
+  } else {
+    tare_needed = true;
+  }
+  int32_t stored_balance;
+  if (loadBalanceOffset(stored_balance)) {
+    balance_tracker.setOffset(stored_balance);
+    balance_tracker.startRefine(REFINE_MAX_KG * counts_per_kg);
+  } else {
+    balance_tracker.startTare();
+  }
 
-  pinMode(CALIPER_CLK_PIN, INPUT);
-  pinMode(CALIPER_DATA_PIN, INPUT);
+  bool adc_ready = hx711.begin(LOADCELL_DOUT_PIN, LOADCELL_SCK_PIN, LOADCELL_GAIN);
+#if LOADCELL_LAYOUT == LOADCELL_SECOND_HX711
+  adc_ready &= second_hx711.begin(SECOND_LOADCELL_DOUT_PIN, SECOND_LOADCELL_SCK_PIN, LOADCELL_GAIN,
+                                  SPI3_HOST);
+#endif
+  if (!adc_ready) {
+    Serial.println(F("HX711 SPI setup failed"));
+    for (;;);
+  }
+
+  // setup() runs on SAMPLING_CORE, so the caliper interrupt is serviced there
+  startCaliper(CALIPER_CLK_PIN, CALIPER_DATA_PIN);
 
-  attachInterrupt(digitalPinToInterrupt(CALIPER_CLK_PIN), readCaliperData, FALLING);
   pinMode(TARE_PIN, INPUT_PULLUP);
   attachInterrupt(digitalPinToInterrupt(TARE_PIN), tareScale, FALLING);
 
@@ -120,14 +347,14 @@ void setup() {
 
   display.clearDisplay();
 
-  my_timer = timerBegin(0, 80, true);
-  timerAttachInterrupt(my_timer, &onTimer, true);
-  timerAlarmWrite(my_timer, step_us, true);
-  timerAlarmEnable(my_timer);
+  config = defaultConfig(counts_per_kg, LOADCELL_COUNT);
+  config_generation++;
 
   // Initialize BLE
   BLEDevice::init("ESP32_Tamper");
+  BLEDevice::setMTU(BATCH_MAX_BYTES + 3);
   pServer = BLEDevice::createServer();
+  pServer->setCallbacks(new ServerCallbacks());
   pService = pServer->createService(SERVICE_UUID);
   pCharacteristic = pService->createCharacteristic(
                       CHARACTERISTIC_UUID,
@@ -137,6 +364,19 @@ void setup() {
                     );
 
   pCharacteristic->addDescriptor(new BLE2902());
+
+  pControlCharacteristic = pService->createCharacteristic(
+                             CONTROL_CHARACTERISTIC_UUID,
+                             BLECharacteristic::PROPERTY_READ |
+                             BLECharacteristic::PROPERTY_WRITE
+                           );
+  pControlCharacteristic->setCallbacks(new ControlCallbacks());
+  pControlCharacteristic->setValue((uint8_t *)&config, sizeof(config));
+
+  pDebugCharacteristic = pService->createCharacteristic(
+                           DEBUG_CHARACTERISTIC_UUID,
+                           BLECharacteristic::PROPERTY_READ
+                         );
   pService->start();
 
   BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
@@ -146,6 +386,15 @@ void setup() {
   pAdvertising->setMinPreferred(0x12);
   BLEDevice::startAdvertising();
   Serial.println("BLE service started");
+
+  // Start the pipeline
+  xTaskCreatePinnedToCore(sampleTask, "sample", SAMPLE_TASK_STACK, NULL,
+                          SAMPLE_TASK_PRIORITY, &sample_task, SAMPLING_CORE);
+  xTaskCreatePinnedToCore(transportTask, "transport", TRANSPORT_TASK_STACK, NULL,
+                          TRANSPORT_TASK_PRIORITY, &transport_task, IO_CORE);
+  xTaskCreatePinnedToCore(displayTask, "display", DISPLAY_TASK_STACK, NULL,
+                          DISPLAY_TASK_PRIORITY, NULL, IO_CORE);
+  startAcquisition(LOADCELL_CHANNELS, LOADCELL_COUNT, SAMPLING_CORE, sample_task);
 }
 
 void printValue(float value, int decimalPlaces) {
@@ -156,57 +405,368 @@ void printValue(float value, int decimalPlaces) {
   display.print(value, decimalPlaces);
 }
 
-void loop() {
-  if (read_value) {
-    scale_val = scale.get_units();
-
-    if (scale_val > scale_val_max) {
-      scale_val_max = scale_val;
-    }
-
-    if (caliper_val > caliper_val_max) {
-      caliper_val_max = caliper_val;
-    }
-
-    // Prepare data string
-    String data = String(cur_us / 1000000., 1) + "," +
-                  String(scale_val, 3) + "," +
-                  String(caliper_val, 2);
-
-    // Send data via BLE
-    pCharacteristic->setValue(data.c_str());
-    pCharacteristic->notify();
-
-    // Update OLED display
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setTextColor(WHITE);
-    display.setCursor(0, 0);
-    display.setRotation(1);
-
-    display.println("Force (kg)");
-    display.println("");
-    display.setTextSize(2);
-    printValue(scale_val, 2);
-    display.println("");
-    printValue(scale_val_max, 2);
-    display.println("");
-    display.setTextSize(1);
-    display.println("");
-
-    display.println("Pos'n (mm)");
-    display.println("");
-    display.setTextSize(2);
-    printValue(caliper_val, 2);
-    display.println("");
-    printValue(caliper_val_max, 2);
-    display.println("");
-    display.setTextSize(1);
-    display.println("");
-
-    display.display();
+void printSampleRow(const SampleFrame &frame) {
+  float displacement = 0;
+  if (frame.flags & FRAME_FLAG_CALIPER_VALID) displacement = caliperWordToMm(frame.caliper_word);
+
+  char row[64];
+  int length = snprintf(row, sizeof(row), "%.6f,%.3f,%.2f,%.3f\n", frame.timestamp_us / 1e6,
+                        frame.force_counts / counts_per_kg, displacement,
+                        frame.balance_counts / counts_per_kg);
+  Serial.write((const uint8_t *)row, length);
+}
+
+void flushBatch(SampleBatcher &batch) {
+  // Send data via BLE
+  uint32_t start = cycleCount();
+  pCharacteristic->setValue((uint8_t *)batch.data(), batch.size());
+  pCharacteristic->notify();
+  profileStage(STAGE_NOTIFY, start);
+  batch.clear();
+}
+
+// Resend the requested frames that are still in history. Each packet starts
+// with a keyframe so it can be decoded on its own.
+void resendFrames(const RetransmitRequest &request) {
+  resend_batcher.setMtu(negotiated_mtu);
+  resend_batcher.setMaxSamples(HISTORY_SIZE);
+  resend_batcher.reset();
+
+  for (uint16_t n = 0; n < request.count && n < HISTORY_SIZE; n++) {
+    uint16_t sequence = request.first + n;
+    const SampleFrame &frame = history[sequence % HISTORY_SIZE];
+    if (frame.sequence != sequence || (uint16_t)(history_next - sequence - 1) >= HISTORY_SIZE) {
+      continue; // never streamed or already overwritten
+    }
+
+    if (resend_batcher.add(frame, micros())) {
+      flushBatch(resend_batcher);
+      resend_batcher.reset();
+    }
+  }
+
+  if (!resend_batcher.empty()) flushBatch(resend_batcher);
+}
+
+// Answer a clock sync ping, timestamping the reply as late as possible
+void sendPong(const PingRequest &request) {
+  PongPacket pong;
+  pong.version = PACKET_VERSION_PONG;
+  pong.token = request.token;
+  pong.receive_us = request.receive_us;
+  pong.transmit_us = (uint32_t)esp_timer_get_time();
+  pCharacteristic->setValue((uint8_t *)&pong, sizeof(pong));
+  pCharacteristic->notify();
+}
+
+// Fit a caliper time offset into the frame, saturating for very stale values
+int32_t clampOffset(int64_t offset_us) {
+  if (offset_us < INT32_MIN) return INT32_MIN;
+  if (offset_us > INT32_MAX) return INT32_MAX;
+  return (int32_t)offset_us;
+}
+
+// Hand a frame to the transport task on the other core
+void streamFrame(SampleFrame frame) {
+  frame.flags |= pending_flags;
+  frame.sequence = frame_sequence++;
+  pending_flags = 0;
+
+  if (!transport_ring.push(frame)) {
+    pending_flags |= FRAME_FLAG_OVERRUN;
+  }
+}
+
+// Zero, filter and decimate one conversion, and frame it if a sample is due
+void processReading(const ForceReading &reading, const DeviceConfig &local) {
+  // Flag conversions lost to a full ring buffer
+  if (force_overruns != reported_overruns) {
+    reported_overruns = force_overruns;
+    pending_flags |= FRAME_FLAG_OVERRUN;
+  }
+
+  // Combine with the conversions of the other load cells from this round
+  loadcell_counts[reading.channel] = reading.counts;
+  loadcells_seen |= 1 << reading.channel;
+  if (loadcells_seen != (1 << LOADCELL_COUNT) - 1) return;
+  loadcells_seen = 0;
+
+  int32_t total = 0;
+  for (int i = 0; i < LOADCELL_COUNT; i++) total += loadcell_counts[i];
+  int32_t balance = LOADCELL_COUNT > 1 ? loadcell_counts[1] - loadcell_counts[0] : 0;
+
+  // Track the zero offsets, leaving them alone around a tamp. Both tares
+  // start and finish together.
+  bool quiet = detector.state() == detector.IDLE;
+  zero_tracker.add(total, quiet);
+  balance_tracker.add(balance, quiet);
+  balance_tracker.takeTared();
+  if (zero_tracker.takeTared()) {
+    pending_flags |= FRAME_FLAG_TARED;
+    display_flags |= FRAME_FLAG_TARED;
+    offset_to_save = zero_tracker.offset();
+    balance_to_save = balance_tracker.offset();
+    save_offset = true;
+  }
+
+  // Filter and decimate. The filter is shift invariant, so the offset
+  // can come off afterwards and change without disturbing its history.
+  bool due = force_filter.push(total, reading.timestamp_us);
+  balance_filter.push(balance, reading.timestamp_us);
+  if (!due) return;
+  int32_t force_counts = force_filter.value() - zero_tracker.offset();
+  uint64_t sample_us = force_filter.timestamp();
+
+  // At rest show at most one sample per sample period, during a burst
+  // every decimated one. The detector sees them all, so the lead-in of a
+  // burst is at the full rate.
+  bool shown_due = detector.burst(force_counts) || local.sample_period_us == 0 ||
+                   sample_us - last_sample_us >= local.sample_period_us;
+  if (shown_due) last_sample_us = sample_us;
+
+  // Prepare data frame
+  SampleFrame frame;
+  frame.version = PROTOCOL_VERSION;
+  frame.flags = frame_flags;
+  frame.sequence = 0; // assigned when streamed
+  frame.timestamp_us = (uint32_t)sample_us;
+  frame.force_counts = force_counts;
+  frame.caliper_word = caliper_word;
+  frame.caliper_offset_us = clampOffset((int64_t)(caliper_us - sample_us));
+  frame.balance_counts = balance_filter.value() - balance_tracker.offset();
+
+  // The display only needs recent frames, so it is allowed to miss some.
+  // Transport only gets what the detector passes.
+  if (shown_due) {
+    SampleFrame shown = frame;
+    shown.flags |= display_flags;
+    if (display_ring.push(shown)) display_flags = 0;
+  }
+  detector.process(frame, sample_us, streamFrame);
+}
+
+// Turn HX711 conversions into sample frames for transport and display
+void sampleTask(void *param) {
+  DeviceConfig local = defaultConfig(counts_per_kg);
+  uint32_t seen = 0;
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    if (updateConfig(local, seen)) {
+      detector.setThresholds(local.arm_force_kg * local.counts_per_kg,
+                             local.trigger_force_kg * local.counts_per_kg);
+      detector.setHeartbeat(local.heartbeat_ms * 1000UL);
+      detector.setHoldoff(local.holdoff_ms * 1000UL);
+      detector.setHistoryDepth(local.pretrigger_frames);
+      force_filter.configure(local.median_taps, local.averaging, local.filter_order,
+                             local.decimation);
+      balance_filter.configure(local.median_taps, local.averaging, local.filter_order,
+                               local.decimation);
+      zero_tracker.setBand(local.auto_zero_g * local.counts_per_kg / 1000);
+      balance_tracker.setBand(local.auto_zero_g * local.counts_per_kg / 1000);
+    }
+
+    uint32_t start = cycleCount();
+    CaliperEdge edge;
+    bool decoded = false;
+    while (caliper_edges.pop(edge)) {
+      decoded = true;
+      if (caliper_decoder.feed(edge)) {
+        caliper_word = caliper_decoder.word();
+        caliper_us = caliper_decoder.timestamp();
+        frame_flags |= FRAME_FLAG_CALIPER_VALID;
+      }
+    }
+    if (decoded) profileStage(STAGE_CALIPER_DECODE, start);
+
+    if (tare_needed) {
+      tare_needed = false;
+      zero_tracker.startTare();
+      balance_tracker.startTare();
+    }
+
+    ForceReading reading;
+    while (force_ring.pop(reading)) {
+      stage_profiles[STAGE_READY_LATENCY].record(esp_timer_get_time() - reading.timestamp_us);
+      start = cycleCount();
+      processReading(reading, local);
+      profileStage(STAGE_FORCE, start);
+    }
+    xTaskNotifyGive(transport_task);
+  }
+}
+
+// Batch frames into notifications
+void transportTask(void *param) {
+  DeviceConfig local = defaultConfig(counts_per_kg);
+  uint32_t seen = 0;
+
+  for (;;) {
+    if (updateConfig(local, seen)) {
+      batcher.setMaxSamples(local.batch_samples);
+      batcher.setMaxLatency(local.batch_latency_us);
+    }
+
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(local.batch_latency_us / 1000));
+
+    if (stream_restart) {
+      stream_restart = false;
+      batcher.reset();
+    }
+
+    SampleFrame frame;
+    while (transport_ring.pop(frame)) {
+      history[frame.sequence % HISTORY_SIZE] = frame;
+      history_next = frame.sequence + 1;
+#if SERIAL_SAMPLES
+      printSampleRow(frame);
+#endif
+
+      // Queue frame for the next notification
+      batcher.setMtu(negotiated_mtu);
+      if (batcher.add(frame, micros())) {
+        flushBatch(batcher);
+      }
+    }
+
+    // Send a partial batch once its oldest sample is too old
+    if (batcher.expired(micros())) {
+      flushBatch(batcher);
+    }
+
+    // Pings first, a resend can take a while
+    PingRequest ping;
+    while (ping_requests.pop(ping)) {
+      sendPong(ping);
+    }
+
+    RetransmitRequest request;
+    while (retransmit_requests.pop(request)) {
+      resendFrames(request);
+    }
+  }
+}
+
+// Draw the current values into the display framebuffer
+void renderDisplay() {
+  display.clearDisplay();
+  display.setTextSize(1);
+  display.setTextColor(WHITE);
+  display.setCursor(0, 0);
+  display.setRotation(1);
+
+  display.println("Force (kg)");
+  display.println("");
+  display.setTextSize(2);
+  printValue(scale_val, 2);
+  display.println("");
+  printValue(scale_val_max, 2);
+  display.println("");
+  display.setTextSize(1);
+  display.println("");
+
+  display.println("Pos'n (mm)");
+  display.println("");
+  display.setTextSize(2);
+  printValue(caliper_val, 2);
+  display.println("");
+  printValue(caliper_val_max, 2);
+  display.println("");
+  display.setTextSize(1);
+  display.println("");
+}
+
+// Send one changed run of a display page over I2C
+void sendDisplayRun(int page, int first, int last, const uint8_t *data) {
+  display.ssd1306_command(SSD1306_PAGEADDR);
+  display.ssd1306_command(page);
+  display.ssd1306_command(page);
+  display.ssd1306_command(SSD1306_COLUMNADDR);
+  display.ssd1306_command(first);
+  display.ssd1306_command(last);
+
+  int remaining = last - first + 1;
+  while (remaining > 0) {
+    int chunk = remaining < OLED_CHUNK ? remaining : OLED_CHUNK;
+    Wire.beginTransmission(SCREEN_ADDRESS);
+    Wire.write((uint8_t)0x40); // Co = 0, D/C = 1: data stream
+    Wire.write(data, chunk);
+    Wire.endTransmission();
+    data += chunk;
+    remaining -= chunk;
+  }
+}
+
+// Print stage timings and leave them in the debug characteristic, then
+// start a new interval
+void reportProfile() {
+  static char report[PROFILE_REPORT_SIZE];
+  size_t length = formatProfile(report, sizeof(report));
+  clearProfile();
+
+  Serial.print(report);
+  pDebugCharacteristic->setValue((uint8_t *)report, length);
+}
+
+// Redraw the OLED and LEDs at a fixed rate from the latest frames, save
+// tare offsets and report stage timings
+void displayTask(void *param) {
+  DeviceConfig local = defaultConfig(counts_per_kg);
+  uint32_t seen = 0;
+  TickType_t wake = xTaskGetTickCount();
+  uint32_t last_report_ms = millis();
+
+  for (;;) {
+    updateConfig(local, seen);
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(1000 / local.display_rate_hz));
+
+    // Keep a new tare for the next boot, off the sampling core
+    if (save_offset) {
+      save_offset = false;
+      uint32_t start = cycleCount();
+      saveCalibration(counts_per_kg, offset_to_save, balance_to_save);
+      profileStage(STAGE_NVS_SAVE, start);
+    }
+
+    if (millis() - last_report_ms >= PROFILE_REPORT_MS) {
+      last_report_ms = millis();
+      reportProfile();
+    }
+
+    SampleFrame frame;
+    bool updated = false;
+    while (display_ring.pop(frame)) {
+      if (frame.flags & FRAME_FLAG_TARED) {
+        scale_val_max = -1000;
+        caliper_val_max = -1000;
+      }
+
+      scale_val = frame.force_counts / counts_per_kg;
+      caliper_val = caliperWordToMm(frame.caliper_word);
+
+      if (scale_val > scale_val_max) {
+        scale_val_max = scale_val;
+      }
+
+      if (caliper_val > caliper_val_max) {
+        caliper_val_max = caliper_val;
+      }
+
+      updated = true;
+    }
+    if (!updated) continue;
+
+    // Render in RAM, then send only what changed
+    uint32_t start = cycleCount();
+    renderDisplay();
+    profileStage(STAGE_RENDER, start);
+    start = cycleCount();
+    display_diff.flush(display.getBuffer(), sendDisplayRun);
+    profileStage(STAGE_OLED_FLUSH, start);
 
     // Update LEDs
+    start = cycleCount();
     if (scale_val > 30 / 2.2) {
       digitalWrite(LED_GRN_PIN, 0);
       digitalWrite(LED_RED_PIN, 1);
@@ -214,20 +774,11 @@ void loop() {
       digitalWrite(LED_GRN_PIN, 1);
       digitalWrite(LED_RED_PIN, 0);
     }
-
-    read_value = false;
-  }
-
-  if (data_ready) {
-    caliper_val = (word1 & ~(15 << 20)) / 100.0;
-    if (word1 & (1 << 20)) caliper_val = -caliper_val;
-    data_ready = false;
+    profileStage(STAGE_LEDS, start);
   }
+}
 
-  if (tare_needed) {
-    scale.tare();
-    scale_val_max = -1000;
-    caliper_val_max = -1000;
-    tare_needed = false;
-  }
+void loop() {
+  // All work happens in the pipeline tasks started by setup()
+  vTaskDelete(NULL);
 }
@@ -0,0 +1,29 @@
+#include <stdio.h>
+
+#include "profiler.h"
+
+StageProfile stage_profiles[STAGE_COUNT];
+
+static const char *const STAGE_NAMES[STAGE_COUNT] = {
+  "read", "ready", "caliper", "force", "notify", "render", "oled", "leds", "nvs",
+};
+
+size_t formatProfile(char *out, size_t size) {
+  float cycles_per_us = ESP.getCpuFreqMHz();
+  size_t length = snprintf(out, size, "stage n min/avg/p99/max us\n");
+
+  for (int i = 0; i < STAGE_COUNT && length < size; i++) {
+    StageProfile::Summary s = stage_profiles[i].summary();
+    if (s.count == 0) continue;
+
+    float scale = i == STAGE_READY_LATENCY ? 1 : 1 / cycles_per_us;
+    length += snprintf(out + length, size - length, "%s %u %.1f/%.1f/%.1f/%.1f\n", STAGE_NAMES[i],
+                       (unsigned)s.count, s.min * scale, s.avg * scale, s.p99 * scale,
+                       s.max * scale);
+  }
+  return length < size ? length : size - 1;
+}
+
+void clearProfile() {
+  for (int i = 0; i < STAGE_COUNT; i++) stage_profiles[i].clear();
+}